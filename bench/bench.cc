@@ -0,0 +1,306 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Benchmark of the search on a fixed, versioned corpus of positions.
+//
+// Usage: gomoku_bench [-c <corpus>] [-r <repetitions>] [-t <threads>] [-p <profile>] [-m <table_megabytes>]
+//                     [-f <phases>] [-b <baseline.json>] [-x <tolerance_percent>] [-o <output.json>]
+//
+// Every position is searched at each even depth up to its corpus depth. Per position
+// the results contain nodes/s and evals/s at full depth, time to reach each depth
+// and the best move found at each depth. Results are written as JSON. If a baseline
+// (a previous output) is given, speed is compared and the exit code is 1 when total
+// nodes/s dropped by more than the tolerance. Searches use a RenjuAIProfile (built-in name
+// or file, "default" if omitted), its values are written with the results, along with the memory of the
+// transposition table and its hit rate and usage per position. With -f 1, cycles and calls of search phases
+// (RenjuAIPhaseProfiler) are written per position; timing them slows the search down.
+
+#include <ai/ai_controller.h>
+#include <ai/phase_profiler.h>
+#include <ai/profile.h>
+#include <ai/search_context.h>
+#include <ai/transposition_table.h>
+#include <api/renju_api.h>
+#include <utils/json.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef BLUPIG_BENCH_CORPUS
+#define BLUPIG_BENCH_CORPUS "bench/corpus_v1.txt"
+#endif
+
+// Default number of runs per search, the median time is reported
+#define kBenchRepetitions 3
+
+// Default allowed drop of total nodes/s against a baseline (percent)
+#define kBenchTolerance 10
+
+struct BenchPosition {
+    std::string name;
+    int board_size;
+    int ai_player;
+    int search_depth;
+    std::string gs_string;
+};
+
+struct BenchDepthResult {
+    int depth;
+    double time_ms;
+    unsigned int node_count;
+    unsigned int eval_count;
+    int move_r, move_c;
+    double tt_hit_rate, tt_usage;
+    RenjuAIPhaseProfiler::Counters phases;
+};
+
+// Reads a corpus file, returns the corpus version (0: Invalid)
+static int readCorpus(const std::string &path, std::vector<BenchPosition> *positions) {
+    std::ifstream file(path);
+    if (!file) return 0;
+
+    int version = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream stream(line);
+        if (line.compare(0, 8, "version ") == 0) {
+            std::string key;
+            stream >> key >> version;
+            continue;
+        }
+
+        BenchPosition p;
+        if (!(stream >> p.name >> p.board_size >> p.ai_player >> p.search_depth >> p.gs_string) ||
+            p.gs_string.size() != static_cast<size_t>(p.board_size * p.board_size)) {
+            std::cerr << "Invalid corpus line: " << line.substr(0, 40) << std::endl;
+            return 0;
+        }
+        positions->push_back(p);
+    }
+    return version;
+}
+
+// Searches a position at a fixed depth, time is the median of all repetitions
+static BenchDepthResult searchPosition(const BenchPosition &p, int depth, int repetitions, int num_threads,
+                                       const RenjuAIProfile &profile, RenjuAITranspositionTable *tt) {
+    std::vector<char> gs(p.gs_string.size());
+    RenjuAPI::gsFromString(p.gs_string.c_str(), p.board_size, gs.data());
+
+    BenchDepthResult result = {depth, 0, 0, 0, -1, -1, 0, 0, {}};
+    std::vector<double> times;
+    for (int i = 0; i < repetitions; ++i) {
+        // Every run starts from an empty table, clearing is not timed
+        tt->clear();
+        RenjuAISearchContext ctx(p.board_size);
+        ctx.tt = tt;
+        profile.apply(&ctx);
+
+        int actual_depth, winning_player;
+        auto t_start = std::chrono::steady_clock::now();
+        RenjuAIController::generateMove(&ctx, gs.data(), p.ai_player, depth, 0, num_threads,
+                                        &actual_depth, &result.move_r, &result.move_c, &winning_player,
+                                        &result.node_count, &result.eval_count, nullptr);
+        auto t_end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(t_end - t_start).count());
+        if (!ctx.iterations.empty()) {
+            result.tt_hit_rate = ctx.iterations.back().ttHitRate();
+            result.tt_usage = ctx.iterations.back().tt_usage;
+        }
+        result.phases = ctx.phases;
+    }
+    std::sort(times.begin(), times.end());
+    result.time_ms = times[times.size() / 2];
+    return result;
+}
+
+static double perSecond(double count, double time_ms) {
+    return time_ms > 0 ? count * 1000.0 / time_ms : 0;
+}
+
+// Compares results against a baseline, returns false on a regression
+static bool compareBaseline(const nlohmann::json &baseline, int tolerance, nlohmann::json *output) {
+    nlohmann::json comparison;
+    auto base_positions = baseline.find("positions");
+    if (base_positions == baseline.end() || !base_positions->is_array()) {
+        std::cerr << "Invalid baseline." << std::endl;
+        return false;
+    }
+
+    // Per position, informational since single positions are noisy
+    for (auto &p : (*output)["positions"]) {
+        for (auto &b : *base_positions) {
+            if (b["name"] != p["name"]) continue;
+            double nps_ratio = b["nodes_per_sec"].get<double>() > 0 ?
+                p["nodes_per_sec"].get<double>() / b["nodes_per_sec"].get<double>() : 0;
+            bool move_changed = b["best_move"] != p["best_move"];
+            comparison["positions"][p["name"].get<std::string>()] = {
+                {"nodes_per_sec_ratio", nps_ratio},
+                {"node_count_ratio", b["node_count"].get<double>() > 0 ?
+                    p["node_count"].get<double>() / b["node_count"].get<double>() : 0},
+                {"time_ratio", b["time_ms"].get<double>() > 0 ?
+                    p["time_ms"].get<double>() / b["time_ms"].get<double>() : 0},
+                {"best_move_changed", move_changed}};
+            if (move_changed) std::cerr << "Best move changed: " << p["name"].get<std::string>() << std::endl;
+        }
+    }
+
+    // Totals decide the result
+    double base_nps = baseline["total"]["nodes_per_sec"].get<double>();
+    double nps = (*output)["total"]["nodes_per_sec"].get<double>();
+    double ratio = base_nps > 0 ? nps / base_nps : 0;
+    bool regressed = ratio < 1.0 - tolerance / 100.0;
+    comparison["total"] = {{"nodes_per_sec_ratio", ratio},
+                           {"tolerance_percent", tolerance},
+                           {"regressed", regressed}};
+    (*output)["comparison"] = comparison;
+
+    std::cerr << "Total nodes/s vs baseline: " << ratio * 100 << "%" << (regressed ? " (regression)" : "")
+              << std::endl;
+    return !regressed;
+}
+
+int main(int argc, char const *argv[]) {
+    std::string corpus_path = BLUPIG_BENCH_CORPUS, baseline_path, output_path;
+    int repetitions = kBenchRepetitions;
+    int num_threads = 1;
+    int tolerance = kBenchTolerance;
+    int tt_size_log2 = kRenjuAiTTDefaultSizeLog2;
+    RenjuAIProfile profile;
+    std::string error;
+
+    for (int i = 1; i < argc - 1; i += 2) {
+        if (strcmp(argv[i], "-c") == 0) corpus_path = argv[i + 1];
+        else if (strcmp(argv[i], "-r") == 0) repetitions = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-t") == 0) num_threads = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-b") == 0) baseline_path = argv[i + 1];
+        else if (strcmp(argv[i], "-x") == 0) tolerance = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-o") == 0) output_path = argv[i + 1];
+        else if (strcmp(argv[i], "-f") == 0) RenjuAIPhaseProfiler::setEnabled(atoi(argv[i + 1]) != 0);
+        else if (strcmp(argv[i], "-m") == 0)
+            tt_size_log2 = RenjuAITranspositionTable::sizeLog2(static_cast<size_t>(std::max(1, atoi(argv[i + 1]))));
+        else if (strcmp(argv[i], "-p") == 0 && !RenjuAIProfile::load(argv[i + 1], &profile, &error)) {
+            std::cerr << "Invalid profile: " << error << std::endl;
+            return 2;
+        }
+    }
+
+    std::vector<BenchPosition> positions;
+    int corpus_version = readCorpus(corpus_path, &positions);
+    if (corpus_version == 0) {
+        std::cerr << "Unable to read corpus: " << corpus_path << std::endl;
+        return 2;
+    }
+
+    RenjuAITranspositionTable tt(tt_size_log2);
+    nlohmann::json output;
+    output["corpus_version"] = corpus_version;
+    output["build"] = std::string(__DATE__) + " " + __TIME__;
+    output["repetitions"] = repetitions;
+    output["num_threads"] = num_threads;
+    output["profile"] = {{"name", profile.name},
+                         {"breadth", profile.breadth},
+                         {"pattern_scores", profile.pattern_scores}};
+    output["tt"] = {{"memory_mb", tt.memoryBytes() / static_cast<double>(1 << 20)},
+                    {"huge_pages", tt.hugePages()}};
+    output["positions"] = nlohmann::json::array();
+
+    // Pattern tables are built before timing
+    searchPosition(positions[0], 2, 1, 1, profile, &tt);
+
+    double total_time = 0, total_nodes = 0, total_evals = 0;
+    for (const auto &p : positions) {
+        std::vector<BenchDepthResult> results;
+        for (int d = 2; d <= p.search_depth; d += 2)
+            results.push_back(searchPosition(p, d, repetitions, num_threads, profile, &tt));
+        const BenchDepthResult &last = results.back();
+
+        // Best move is stable from the shallowest depth after which it no longer changes
+        int stable_from_depth = last.depth;
+        for (int i = static_cast<int>(results.size()) - 1; i >= 0; --i) {
+            if (results[i].move_r != last.move_r || results[i].move_c != last.move_c) break;
+            stable_from_depth = results[i].depth;
+        }
+
+        nlohmann::json time_to_depth, best_moves;
+        for (const auto &r : results) {
+            time_to_depth[std::to_string(r.depth)] = r.time_ms;
+            best_moves[std::to_string(r.depth)] = {r.move_r, r.move_c};
+        }
+
+        nlohmann::json result = {{"name", p.name},
+                                 {"board_size", p.board_size},
+                                 {"search_depth", last.depth},
+                                 {"time_ms", last.time_ms},
+                                 {"node_count", last.node_count},
+                                 {"eval_count", last.eval_count},
+                                 {"nodes_per_sec", perSecond(last.node_count, last.time_ms)},
+                                 {"evals_per_sec", perSecond(last.eval_count, last.time_ms)},
+                                 {"tt_hit_rate", last.tt_hit_rate},
+                                 {"tt_usage", last.tt_usage},
+                                 {"time_to_depth", time_to_depth},
+                                 {"best_moves", best_moves},
+                                 {"best_move", {last.move_r, last.move_c}},
+                                 {"stable_from_depth", stable_from_depth}};
+        if (RenjuAIPhaseProfiler::enabled()) {
+            for (int i = 0; i < kRenjuAiPhaseCount; ++i)
+                result["phases"][RenjuAIPhaseProfiler::phaseName(i)] = {{"cycles", last.phases.cycles[i]},
+                                                                       {"calls", last.phases.calls[i]}};
+        }
+        output["positions"].push_back(result);
+
+        total_time += last.time_ms;
+        total_nodes += last.node_count;
+        total_evals += last.eval_count;
+        std::cerr << p.name << ": depth " << last.depth << ", " << last.time_ms << " ms, "
+                  << static_cast<long>(perSecond(last.node_count, last.time_ms)) << " nodes/s" << std::endl;
+    }
+
+    output["total"] = {{"time_ms", total_time},
+                       {"node_count", total_nodes},
+                       {"eval_count", total_evals},
+                       {"nodes_per_sec", perSecond(total_nodes, total_time)},
+                       {"evals_per_sec", perSecond(total_evals, total_time)}};
+
+    bool passed = true;
+    if (!baseline_path.empty()) {
+        std::ifstream file(baseline_path);
+        nlohmann::json baseline;
+        try {
+            baseline = nlohmann::json::parse(file);
+        } catch (const std::exception &) {
+            std::cerr << "Unable to read baseline: " << baseline_path << std::endl;
+            return 2;
+        }
+        passed = compareBaseline(baseline, tolerance, &output);
+    }
+
+    if (output_path.empty()) {
+        std::cout << output.dump(2) << std::endl;
+    } else {
+        std::ofstream file(output_path);
+        file << output.dump(2) << std::endl;
+    }
+    return passed ? 0 : 1;
+}
@@ -18,12 +18,54 @@
 
 var express = require('express');
 var cors = require('cors');
-var exec = require('child_process').exec;
+var spawn = require('child_process').spawn;
+var readline = require('readline');
+
+// Pending responses by request id
+var pending = {};
+var next_id = 0;
+var engine = null;
 
 console.log('Start listening...');
 start();
 
+// Start a long-running engine process, requests and responses are JSON lines
+function startEngine() {
+  engine = spawn('gomoku', ['serve']);
+
+  readline.createInterface({input: engine.stdout}).on('line', function(line) {
+    var response;
+    try {
+      response = JSON.parse(line);
+    } catch (e) {
+      return;
+    }
+    var server_resp = pending[response.id];
+    if (typeof server_resp === 'undefined') return;
+
+    // Interim moves are streamed one per line before the response
+    if (response.message === 'progress') {
+      server_resp.write(line + '\n');
+      return;
+    }
+    delete pending[response.id];
+
+    // Write response
+    server_resp.write(line);
+    server_resp.end();
+  });
+
+  // Restart engine if it exits, requests in flight are dropped
+  engine.on('exit', function() {
+    for (var id in pending) pending[id].end();
+    pending = {};
+    startEngine();
+  });
+}
+
 function start() {
+  startEngine();
+
   var app = express();
   app.use(cors());
 
@@ -33,18 +75,24 @@ function start() {
     // Get query parameters
     var state = req.query.s;
     var player = req.query.p;
+    var progress = req.query.progress;
+
+    // Build request
+    var id = next_id++;
+    var request = {id: id};
+    if (typeof state === 'string' && state.length > 0) request.s = state;
+    if (typeof player === 'string' && player.length > 0) request.p = player;
+    if (progress === '1') request.progress = 1;
+
+    // Send request
+    pending[id] = server_resp;
+    engine.stdin.write(JSON.stringify(request) + '\n');
 
-    // Build command
-    var cmd = 'gomoku';
-    if (typeof state !== 'undefined' && state.length > 0) cmd += ' -s ' + state;
-    if (typeof player !== 'undefined' && player.length > 0) cmd += ' -p ' + player;
-
-    // Execute command
-    exec(cmd, function(error, stdout, stderr) {
-      // Write response
-      server_resp.write(stdout);
-      // server_resp.write(stderr);
-      server_resp.end();
+    // Stop searching once the client is gone
+    server_resp.on('close', function() {
+      if (pending[id] !== server_resp) return;
+      delete pending[id];
+      engine.stdin.write(JSON.stringify({cancel: id}) + '\n');
     });
   });
   app.listen(8001);
@@ -19,12 +19,16 @@
 #ifndef INCLUDE_AI_AI_CONTROLLER_H_
 #define INCLUDE_AI_AI_CONTROLLER_H_
 
+#include <ai/search_context.h>
+
 class RenjuAIController {
  public:
     RenjuAIController();
     ~RenjuAIController();
 
-    static void generateMove(const char *gs, int player, int search_depth, int time_limit,
+    // Generates a move, statistics of the search are kept in ctx
+    static void generateMove(RenjuAISearchContext *ctx, const char *gs, int player, int search_depth,
+                             int time_limit, int num_threads,
                              int *actual_depth, int *move_r, int *move_c, int *winning_player,
                              unsigned int *node_count, unsigned int *eval_count, unsigned int *pm_count);
 };
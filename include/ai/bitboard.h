@@ -0,0 +1,113 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_BITBOARD_H_
+#define INCLUDE_AI_BITBOARD_H_
+
+#include <ai/utils.h>
+#include <cstdint>
+
+// Largest supported board, every line fits in 32 bits
+#define kRenjuAiBitboardMaxSize 20
+#define kRenjuAiBitboardMaxLines (2 * kRenjuAiBitboardMaxSize - 1)
+
+// Line orientations, in the order of RenjuAIEval::measureAllDirections
+#define kRenjuAiBitboardRow 0           // (0,  1)
+#define kRenjuAiBitboardDiagonal 1      // (1,  1)
+#define kRenjuAiBitboardColumn 2        // (1,  0)
+#define kRenjuAiBitboardAntiDiagonal 3  // (1, -1)
+
+// Game state stored as one bitset per player per line in each orientation.
+// Accessors take the board size as a template argument in specialised kernels.
+// Lines are also stored reversed so that pieces on both sides of a cell
+// can be read with right shifts only.
+class RenjuAIBitboard {
+ public:
+    explicit RenjuAIBitboard(int board_size);
+    RenjuAIBitboard(int board_size, const char *gs);
+    ~RenjuAIBitboard();
+
+    int board_size;
+
+    // Sets the value of a cell (0: Empty)
+    void setCell(int r, int c, int value);
+
+    // Bits after (r, c) in the direction of an orientation,
+    // bit 0 is the cell next to (r, c)
+    template <int kBoardSize = 0>
+    inline uint32_t forward(int player, int orientation, int r, int c) const {
+        int index, pos;
+        locate<kBoardSize>(orientation, r, c, &index, &pos);
+        return lines[0][player - 1][orientation][index] >> (pos + 1);
+    }
+
+    // Bits before (r, c) in the direction of an orientation,
+    // bit 0 is the cell next to (r, c)
+    template <int kBoardSize = 0>
+    inline uint32_t backward(int player, int orientation, int r, int c) const {
+        int index, pos;
+        locate<kBoardSize>(orientation, r, c, &index, &pos);
+        return lines[1][player - 1][orientation][index] >> (kRenjuAiBitboardMaxSize - pos);
+    }
+
+    // Empty cells after and before (r, c), cells outside of the board are not empty
+    template <int kBoardSize = 0>
+    inline uint32_t forwardEmpty(int orientation, int r, int c) const {
+        int index, pos;
+        locate<kBoardSize>(orientation, r, c, &index, &pos);
+        return (valid[0][orientation][index] &
+                ~(lines[0][0][orientation][index] | lines[0][1][orientation][index])) >> (pos + 1);
+    }
+    template <int kBoardSize = 0>
+    inline uint32_t backwardEmpty(int orientation, int r, int c) const {
+        int index, pos;
+        locate<kBoardSize>(orientation, r, c, &index, &pos);
+        return (valid[1][orientation][index] &
+                ~(lines[1][0][orientation][index] | lines[1][1][orientation][index])) >>
+               (kRenjuAiBitboardMaxSize - pos);
+    }
+
+    // Returns the player with 5 or more pieces in a row (0: None).
+    // Lines are scanned with AVX2 or SSE2 if available.
+    int winningPlayer() const;
+
+ private:
+    // [forward / reversed][player][orientation][line]
+    uint32_t lines[2][2][4][kRenjuAiBitboardMaxLines];
+
+    // Cells on the board
+    uint32_t valid[2][4][kRenjuAiBitboardMaxLines];
+
+    // Returns true if any of count lines has 5 pieces in a row
+    static bool hasFive(const uint32_t *lines, int count);
+
+    // Line index and bit position of a cell in an orientation
+    // (reversed lines use bit kRenjuAiBitboardMaxSize - 1 - pos)
+    template <int kBoardSize = 0>
+    inline void locate(int orientation, int r, int c, int *index, int *pos) const {
+        switch (orientation) {
+            case kRenjuAiBitboardRow:      *index = r; *pos = c; break;
+            case kRenjuAiBitboardDiagonal:
+                *index = r - c + RenjuAIUtils::boardSize<kBoardSize>(board_size) - 1; *pos = c; break;
+            case kRenjuAiBitboardColumn:   *index = c; *pos = r; break;
+            default:                       *index = r + c; *pos = r; break;
+        }
+    }
+};
+
+#endif  // INCLUDE_AI_BITBOARD_H_
@@ -0,0 +1,100 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_BOARD_H_
+#define INCLUDE_AI_BOARD_H_
+
+#include <ai/bitboard.h>
+#include <ai/search_context.h>
+#include <vector>
+
+// Value of cells around the board
+#define kRenjuAiBoardSentinel 3
+
+// Game state used by the search.
+// Keeps the heuristic value (RenjuAIEval::evalMove) of every empty cell for
+// both players, updated incrementally when moves are made and unmade.
+class RenjuAIBoard {
+ public:
+    RenjuAIBoard(RenjuAISearchContext *ctx, const char *gs);
+    ~RenjuAIBoard();
+
+    int board_size;
+
+    // Game state
+    inline const char *gs() const { return cells.data(); }
+    inline char cell(int r, int c) const { return cells[board_size * r + c]; }
+    inline const RenjuAIBitboard &bitboard() const { return bits; }
+
+    // Moves made since the board was created (cell indices)
+    inline int moveCount() const { return static_cast<int>(moves.size()); }
+    inline int move(int i) const { return moves[i]; }
+
+    // Empty cells with a piece within 2 cells in row r (bit c: column c)
+    inline uint32_t candidates(int r) const { return candidate_rows[r]; }
+
+    // Heuristic value of an empty cell as a player
+    inline int score(int player, int r, int c) const { return scores[player - 1][board_size * r + c]; }
+
+    // Preallocates undo records for a number of moves
+    void reserve(int max_moves);
+
+    // Places a piece and updates affected heuristic values,
+    // specialised for a board size (0: board_size)
+    template <int kBoardSize = 0>
+    void makeMove(RenjuAISearchContext *ctx, int r, int c, int player);
+
+    // Reverts the last move
+    void unmakeMove();
+
+ private:
+    // A heuristic value before a move
+    struct UndoEntry {
+        int index;
+        int player;
+        int score;
+    };
+
+    std::vector<char> cells;
+    RenjuAIBitboard bits;
+
+    // Cells surrounded by kRenjuAiBoardSentinel, so that walking along a line stops at the border
+    // without bounds checks. Rows have a stride of board_size + 1, the extra column
+    // borders both the end of a row and the start of the next one.
+    std::vector<char> padded;
+    static inline int paddedIndex(int stride, int r, int c) { return stride * (r + 1) + c + 1; }
+
+    // Number of pieces within 2 cells of each cell
+    std::vector<unsigned char> neighbours;
+    uint32_t candidate_rows[kRenjuAiBitboardMaxSize];
+    std::vector<int> scores[2];
+
+    // Undo entries of all moves, and where each move begins
+    std::vector<UndoEntry> undo_entries;
+    std::vector<int> undo_moves;
+    std::vector<int> moves;
+
+    // Adds delta to the neighbour counts around (r, c) and updates candidates
+    void updateNeighbours(int r, int c, int delta);
+
+    // Re-evaluates cells of a player along one direction whose measurement could reach (r, c)
+    template <int kBoardSize>
+    void updateDirection(RenjuAISearchContext *ctx, int r, int c, int dr, int dc, int player);
+};
+
+#endif  // INCLUDE_AI_BOARD_H_
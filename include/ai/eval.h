@@ -22,19 +22,47 @@
 #define kRenjuAiEvalWinningScore 10000
 #define kRenjuAiEvalThreateningScore 300
 
+// Number of distinct direction measurements
+// (length 1-5) x (block count 0-2) x (space count 0-1)
+#define kRenjuAiEvalDMCodes 30
+
+// Number of distinct all-direction measurements,
+// directions are unordered so this is C(kRenjuAiEvalDMCodes + 3, 4)
+#define kRenjuAiEvalADMCodes 40920
+
+// Number of preset patterns. The first one wins, the ones before
+// kRenjuAiEvalThreateningPatterns are threatening and the rest are not.
+#define kRenjuAiEvalPatterns 11
+#define kRenjuAiEvalThreateningPatterns 8
+
+#include <ai/bitboard.h>
+#include <ai/search_context.h>
+#include <cstdint>
+#include <vector>
+
 class RenjuAIEval {
  public:
     RenjuAIEval();
     ~RenjuAIEval();
 
     // Evaluate the entire game state as a player
-    static int evalState(const char *gs, int player);
+    static int evalState(RenjuAISearchContext *ctx, const char *gs, int player);
 
     // Evaluate one possible move as a player
-    static int evalMove(const char *gs, int r, int c, int player);
+    static int evalMove(RenjuAISearchContext *ctx, const char *gs, int r, int c, int player);
+    template <int kBoardSize = 0>
+    static int evalMove(RenjuAISearchContext *ctx, const RenjuAIBitboard &bb, int r, int c, int player);
 
     // Check if any player is winning based on a given state
-    static int winningPlayer(const char *gs);
+    static int winningPlayer(const RenjuAISearchContext *ctx, const char *gs);
+    static int winningPlayer(const RenjuAIBitboard &bb);
+
+    // Preset score of each preset pattern
+    static const int presetScores[kRenjuAiEvalPatterns];
+
+    // Returns the lookup table of evalADM for scores of the preset patterns, to be set as ctx->adm_scores.
+    // Tables are generated once per distinct scores and kept (thread-safe).
+    static const int *scoreTable(const std::vector<int> &pattern_scores);
 
 // Allow testing private members in this class
 #ifndef BLUPIG_TEST
@@ -55,13 +83,19 @@ class RenjuAIEval {
         char space_count;     // Number of spaces in the middle of pattern (-1: Ignore value)
     };
 
-    // An array of preset patterns
-    static DirectionPattern *preset_patterns;
+    // Preset patterns shared by all searches
+    struct PresetPatterns {
+        DirectionPattern *patterns;  // An array of preset patterns
+        int *scores;                 // Preset scores of each preset pattern
+        int size;
+        int skip[6];
+        int *adm_scores;             // Score of every all-direction measurement, by admIndex()
+    };
 
-    // Preset scores of each preset pattern
-    static int *preset_scores;
+    // Preset patterns are generated once on first use (thread-safe)
+    static const PresetPatterns &presetPatterns();
 
-    // Loads preset patterns into memory
+    // Loads preset patterns (with presetScores) into memory
     // preset_patterns_skip is the number of patterns to skip for a maximum
     // measured length in an all_direction_measurement (e.g. longest is 3 pieces
     // in an ADM, then skip first few patterns that require 4 pieces or more).
@@ -70,15 +104,34 @@ class RenjuAIEval {
                                        int *preset_patterns_size,
                                        int *preset_patterns_skip);
 
-    // Evaluates an all-direction measurement
-    static int evalADM(DirectionMeasurement *all_direction_measurement);
+    // Scores every all-direction measurement with preset patterns, by admIndex()
+    static int *generateADMScores(const PresetPatterns &preset);
+
+    // Evaluates an all-direction measurement (table lookup)
+    static int evalADM(RenjuAISearchContext *ctx, DirectionMeasurement *all_direction_measurement);
+
+    // Evaluates an all-direction measurement by matching preset patterns,
+    // used to generate the lookup table of evalADM
+    static int matchPresetPatterns(RenjuAISearchContext *ctx, const PresetPatterns &preset,
+                                   DirectionMeasurement *all_direction_measurement);
+
+    // Maps a direction measurement to [0, kRenjuAiEvalDMCodes)
+    static inline int dmCode(const DirectionMeasurement &dm) {
+        return (dm.length - 1) * 6 + dm.block_count * 2 + dm.space_count;
+    }
+
+    // Maps an all-direction measurement to [0, kRenjuAiEvalADMCodes),
+    // independent of the order of directions
+    static int admIndex(const DirectionMeasurement *all_direction_measurement);
 
     // Tries to match a set of patterns with an all-direction measurement
-    static int matchPattern(DirectionMeasurement *all_direction_measurement,
+    static int matchPattern(RenjuAISearchContext *ctx,
+                            DirectionMeasurement *all_direction_measurement,
                             DirectionPattern *patterns);
 
     // Measures all 4 directions
-    static void measureAllDirections(const char *gs,
+    static void measureAllDirections(const RenjuAISearchContext *ctx,
+                                     const char *gs,
                                      int r,
                                      int c,
                                      int player,
@@ -86,12 +139,52 @@ class RenjuAIEval {
                                      RenjuAIEval::DirectionMeasurement *adm);
 
     // Measure a single direction
-    static void measureDirection(const char *gs,
+    static void measureDirection(const RenjuAISearchContext *ctx,
+                                 const char *gs,
                                  int r, int c,
                                  int dr, int dc,
                                  int player,
                                  bool consecutive,
                                  RenjuAIEval::DirectionMeasurement *result);
+
+    // Measures all 4 directions on a bitboard
+    template <int kBoardSize = 0>
+    static void measureAllDirections(const RenjuAIBitboard &bb,
+                                     int r,
+                                     int c,
+                                     int player,
+                                     bool consecutive,
+                                     RenjuAIEval::DirectionMeasurement *adm);
+
+    // Measures a single orientation (kRenjuAiBitboard*) on a bitboard,
+    // same result as measureDirection in the direction of the orientation
+    template <int kBoardSize = 0>
+    static void measureDirection(const RenjuAIBitboard &bb,
+                                 int r, int c,
+                                 int orientation,
+                                 int player,
+                                 bool consecutive,
+                                 RenjuAIEval::DirectionMeasurement *result);
+
+    // Measures pieces and spaces on one side of a cell,
+    // bit 0 of own / empty is the cell next to it
+    static inline void measureSide(uint32_t own, uint32_t empty, int *space_allowance,
+                                   RenjuAIEval::DirectionMeasurement *result) {
+        // Pieces in a row
+        int n = __builtin_ctz(~own);
+        result->length += n;
+        if (((empty >> n) & 1) == 0) return;
+
+        // A space followed by another piece
+        if (*space_allowance > 0 && ((own >> (n + 1)) & 1)) {
+            (*space_allowance)--; result->space_count++;
+            own >>= n + 1; empty >>= n + 1;
+            n = __builtin_ctz(~own);
+            result->length += n;
+            if (((empty >> n) & 1) == 0) return;
+        }
+        result->block_count--;
+    }
 };
 
 #endif  // INCLUDE_AI_EVAL_H_
@@ -19,6 +19,11 @@
 #ifndef INCLUDE_AI_NEGAMAX_H_
 #define INCLUDE_AI_NEGAMAX_H_
 
+#include <ai/board.h>
+#include <ai/search_context.h>
+#include <ai/utils.h>
+#include <cstdint>
+#include <utility>
 #include <vector>
 
 class RenjuAINegamax {
@@ -26,14 +31,31 @@ class RenjuAINegamax {
     RenjuAINegamax();
     ~RenjuAINegamax();
 
-    static void heuristicNegamax(const char *gs, int player, int depth, int time_limit, bool enable_ab_pruning,
+    // Searches for the best move.
+    // A transposition table is allocated for this search if ctx->tt and ctx->session are nullptr.
+    // With a session, iterative deepening continues from the depth and principal variation
+    // of the previous search if the game followed it.
+    // Iterative deepening (depth -1) aborts at time_limit (ms) and starts no iteration
+    // RenjuAITimeManager does not expect to end in time.
+    static void heuristicNegamax(RenjuAISearchContext *ctx, const char *gs, int player, int depth,
+                                 int time_limit, int num_threads, bool enable_ab_pruning,
                                  int *actual_depth, int *move_r, int *move_c);
 
- private:
-    // Preset search breadth
+    // Same as above specialised for a board size, instantiated for 15 and 19 (0: ctx->board_size)
+    template <int kBoardSize>
+    static void heuristicNegamax(RenjuAISearchContext *ctx, const char *gs, int player, int depth,
+                                 int time_limit, int num_threads, bool enable_ab_pruning,
+                                 int *actual_depth, int *move_r, int *move_c);
+
+    // Preset search breadth, used unless the search context has its own
     // From root to leaf, each element is for 2 layers
     // e.g. {10, 5, 2} -> 10, 10, 5, 5, 2, 2, 2, ...
-    static int presetSearchBreadth[5];
+    static const int presetSearchBreadth[kRenjuAiSearchBreadthLevels];
+
+ private:
+
+    // Breadth of a level (2 plies each) from the root
+    static int searchBreadth(const RenjuAISearchContext *ctx, int level);
 
     // A move (candidate)
     struct Move {
@@ -48,15 +70,78 @@ class RenjuAINegamax {
         }
     };
 
-    static int heuristicNegamax(char *gs, int player, int initial_depth, int depth,
+    // Move lists of all plies, allocated once per search (and per worker thread).
+    // Each ply holds lists of both players and its candidate moves.
+    struct MoveArena {
+        MoveArena(const RenjuAISearchContext *ctx, int max_depth);
+
+        int gs_size;
+        int ply_size;
+        std::vector<Move> moves;
+
+        inline Move *playerMoves(int ply)    { return &moves[ply_size * ply]; }
+        inline Move *opponentMoves(int ply)  { return &moves[ply_size * ply + gs_size]; }
+        inline Move *candidateMoves(int ply) { return &moves[ply_size * ply + 2 * gs_size]; }
+    };
+
+    // Searches the root at a depth and records statistics in ctx->iterations
+    template <int kBoardSize>
+    static void searchIteration(RenjuAISearchContext *ctx, RenjuAIBoard *board, MoveArena *arena,
+                                const RenjuAIUtils::SymmetricHash &hash, int player, int depth, int num_threads,
+                                bool enable_ab_pruning, int *move_r, int *move_c);
+
+    // Reads the principal variation starting with a root move from the transposition table
+    template <int kBoardSize>
+    static void principalVariation(RenjuAISearchContext *ctx, RenjuAIBoard *board, RenjuAIUtils::SymmetricHash hash,
+                                   int player, int depth, int move_r, int move_c,
+                                   std::vector<std::pair<int, int>> *pv);
+
+    // Returns true if the moves made on board are the first ply moves of ctx->pv_hint
+    static bool followsHint(const RenjuAISearchContext *ctx, const RenjuAIBoard *board, int ply);
+
+    // Sorts moves from position first by heuristic values raised by history and killer moves of a ply
+    static void orderMoves(const RenjuAISearchContext *ctx, int ply, int player, Move *moves, int first, int size);
+
+    // Moves a candidate to position first, other moves keep their order
+    static void moveToFront(Move *moves, int first, int size, int r, int c);
+
+    // Score as seen one ply closer to the root, positive scores are decayed
+    static int decayScore(int score);
+
+    template <int kBoardSize>
+    static int heuristicNegamax(RenjuAISearchContext *ctx, RenjuAIBoard *board, MoveArena *arena,
+                                const RenjuAIUtils::SymmetricHash &hash,
+                                int player, int initial_depth, int depth, int num_threads,
                                 bool enable_ab_pruning, int alpha, int beta,
                                 int *move_r, int *move_c);
 
-    // Search possible moves based on a given state, sorted by heuristic values.
-    static void searchMovesOrdered(const char *gs, int player, std::vector<Move> *result);
+    // Executes a move, searches the resulting state and returns the score of the move.
+    // A scout only tests whether the move scores above alpha with a null window,
+    // its score is a bound unless it falls between alpha and beta.
+    template <int kBoardSize>
+    static int searchMove(RenjuAISearchContext *ctx, RenjuAIBoard *board, MoveArena *arena,
+                          RenjuAIUtils::SymmetricHash hash,
+                          int player, int initial_depth, int depth,
+                          bool enable_ab_pruning, int alpha, int beta, const Move &move, bool scout = false);
+
+    // Scores moves on multiple threads, each with its own copy of game state, context and arena.
+    // Threads share the transposition table and raise a common alpha.
+    template <int kBoardSize>
+    static void searchMovesParallel(RenjuAISearchContext *ctx, const RenjuAIBoard *board,
+                                    const RenjuAIUtils::SymmetricHash &hash,
+                                    int player, int initial_depth, int depth, int num_threads,
+                                    bool enable_ab_pruning, int alpha, int beta,
+                                    Move *moves, int size);
+
+    // Search possible moves based on a given state, writes them to result
+    // and returns the number of moves. Only the first `count` moves are
+    // sorted by heuristic values.
+    template <int kBoardSize>
+    static int searchMovesOrdered(RenjuAISearchContext *ctx, const RenjuAIBoard *board, int player,
+                                  int count, Move *result);
 
     // Currently not used
-    static int negamax(char *gs, int player, int depth,
+    static int negamax(RenjuAISearchContext *ctx, char *gs, int player, int depth,
                        int *move_r, int *move_c);
 };
 
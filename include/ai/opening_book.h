@@ -0,0 +1,101 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_OPENING_BOOK_H_
+#define INCLUDE_AI_OPENING_BOOK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// File format version
+#define kRenjuAiBookVersion 1
+
+// Zobrist keys of book files are generated from a fixed seed and cover boards up to 20 x 20
+#define kRenjuAiBookZobristSeed 0x626c75706967626bULL
+#define kRenjuAiBookZobristSize 400
+
+// A read-only opening book mapped into memory.
+// File layout (little endian): a 32 byte header ("BLUPIGBK", version, entry size, entry count,
+// reserved), followed by entries sorted by key. Keys are the same for all 8 symmetries of a state,
+// and for both colours: stones are hashed as own or opponent stones of the player to move.
+// Pages of a mapped book are shared by all processes using the same file.
+class RenjuAIOpeningBook {
+ public:
+    RenjuAIOpeningBook();
+    ~RenjuAIOpeningBook();
+
+    // A book move, in the orientation the key was computed with
+    struct Entry {
+        uint64_t key;
+        uint8_t board_size;
+        uint8_t move_r;
+        uint8_t move_c;
+        uint8_t depth;        // Depth the move was searched with
+        uint32_t reserved;
+    };
+
+    // Maps a book file, returns false if it is missing or invalid
+    bool open(const char *path);
+
+    // Unmaps the book file
+    void close();
+
+    bool isOpen() const { return entries != nullptr; }
+    uint64_t size() const { return count; }
+
+    // Looks up the move of player in a game state, returns false if not found
+    bool lookup(const char *gs, int board_size, int player, int *move_r, int *move_c) const;
+
+    // Computes the book key of a game state with player to move.
+    // symmetry is set to the symmetry (RenjuAIUtils::symmetricCell) the key was computed with.
+    static uint64_t key(const char *gs, int board_size, int player, int *symmetry);
+
+    // Creates the entry of a move in a game state
+    static Entry makeEntry(const char *gs, int board_size, int player, int move_r, int move_c, int depth);
+
+    // Writes a book file, the first of entries with the same key is kept
+    static bool write(const char *path, std::vector<Entry> entries);
+
+ private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t entry_size;
+        uint64_t count;
+        uint64_t reserved;
+    };
+
+    // Mapped file
+    void *data;
+    size_t data_size;
+    const Entry *entries;
+    uint64_t count;
+
+    // Zobrist keys of own and opponent stones
+    struct ZobristKeys {
+        uint64_t own[kRenjuAiBookZobristSize];
+        uint64_t opponent[kRenjuAiBookZobristSize];
+        ZobristKeys();
+    };
+    static const ZobristKeys &zobristKeys();
+
+    static const char kMagic[8];
+};
+
+#endif  // INCLUDE_AI_OPENING_BOOK_H_
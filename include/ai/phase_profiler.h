@@ -0,0 +1,111 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_PHASE_PROFILER_H_
+#define INCLUDE_AI_PHASE_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Phases of a search, a phase includes the time of phases called from it
+#define kRenjuAiPhaseSearch 0          // RenjuAIController::generateMove, wall time on the calling thread
+#define kRenjuAiPhaseThreatSolver 1    // RenjuAIThreatSolver::solve
+#define kRenjuAiPhaseBoardUpdate 2     // RenjuAIBoard::makeMove and unmakeMove
+#define kRenjuAiPhaseMoveGeneration 3  // Collecting candidate moves
+#define kRenjuAiPhaseSorting 4         // Sorting candidate moves
+#define kRenjuAiPhaseEvalMove 5        // RenjuAIEval::evalMove
+#define kRenjuAiPhasePatternMatch 6    // RenjuAIEval::evalADM and matchPattern
+#define kRenjuAiPhaseRemoteCell 7      // RenjuAIUtils::remoteCell
+#define kRenjuAiPhaseCount 8
+
+// Cycle counts of search phases, kept per thread.
+// Timing is built into every binary and off unless enabled, an idle scope only reads a flag.
+class RenjuAIPhaseProfiler {
+ public:
+    // Cycles and calls of each phase
+    struct Counters {
+        uint64_t cycles[kRenjuAiPhaseCount];
+        uint64_t calls[kRenjuAiPhaseCount];
+
+        void clear();
+        void add(const Counters &other);
+
+        // Counts added since an earlier copy of the same counters
+        Counters since(const Counters &begin) const;
+    };
+
+    // Times the lifetime of the scope as a phase if enabled
+    class Scope {
+     public:
+        explicit Scope(int phase) : phase(enabled() ? phase : -1), begin(0) {
+            if (this->phase >= 0) begin = cycles();
+        }
+        ~Scope() {
+            if (phase < 0) return;
+            thread_counters.cycles[phase] += cycles() - begin;
+            ++thread_counters.calls[phase];
+        }
+
+     private:
+        int phase;
+        uint64_t begin;
+    };
+
+    // Turns timing on or off for all threads (default: off)
+    static void setEnabled(bool enabled);
+    static bool enabled() { return enabled_flag.load(std::memory_order_relaxed); }
+
+    // Counters of the calling thread since it started
+    static const Counters &threadCounters() { return thread_counters; }
+
+    // Time stamp counter of the CPU, a steady clock in nanoseconds where there is none
+    static uint64_t cycles() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#elif defined(__aarch64__)
+        uint64_t value;
+        asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+        return value;
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    // Name of a phase (e.g. "eval_move")
+    static const char *phaseName(int phase);
+
+    // One line breakdown: cycles of the search, then the share of the search and the calls of each phase
+    // ("cycles=1200000 threat_solver=2.1%/1 ..."). Phases add up over search threads, so with several
+    // threads a share is of the wall time and can exceed 100%.
+    static std::string toString(const Counters &counters);
+
+ private:
+    static std::atomic<bool> enabled_flag;
+    static thread_local Counters thread_counters;
+};
+
+#endif  // INCLUDE_AI_PHASE_PROFILER_H_
@@ -0,0 +1,78 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_PROFILE_H_
+#define INCLUDE_AI_PROFILE_H_
+
+#include <ai/search_context.h>
+#include <string>
+#include <vector>
+
+// Largest breadth accepted, the cells of the largest board
+#define kRenjuAiProfileMaxBreadth 400
+
+// Search and evaluation parameters tuned for a kind of game (e.g. fast casual games or tournaments).
+// Profiles are built in or read from text of "key = value" lines:
+//   base = fast                  Built-in profile the following lines change (default: "default")
+//   name = tier-2                Name reported with results (default: the built-in name)
+//   breadth = 17, 7, 5, 3, 3     Moves searched per node, each value for 2 plies from the root
+//   patterns = 10000, 700, ...   Score of each RenjuAIEval preset pattern
+// Empty lines and lines starting with '#' are ignored.
+class RenjuAIProfile {
+ public:
+    // The "default" profile (RenjuAINegamax and RenjuAIEval presets)
+    RenjuAIProfile();
+    ~RenjuAIProfile();
+
+    std::string name;
+    std::vector<int> breadth;
+    std::vector<int> pattern_scores;
+
+    // Built-in profiles: "default", "fast" and "tournament", returns false if there is none of the name
+    static bool builtIn(const std::string &name, RenjuAIProfile *profile);
+
+    // Parses profile text, returns false with error set if it is malformed or invalid
+    static bool parse(const std::string &text, RenjuAIProfile *profile, std::string *error);
+
+    // Same as above for a built-in profile name or the path of a profile file
+    static bool load(const std::string &name_or_path, RenjuAIProfile *profile, std::string *error);
+
+    // Checks the values against what the search relies on, error describes the first invalid one.
+    // Breadth values are 1 to kRenjuAiProfileMaxBreadth. The winning pattern scores kRenjuAiEvalWinningScore
+    // to 10 times that, other threatening patterns at least kRenjuAiEvalThreateningScore and less than
+    // winning, the rest 0 or more and less than threatening.
+    bool validate(std::string *error) const;
+
+    // Makes a search use this (valid) profile
+    void apply(RenjuAISearchContext *ctx) const;
+
+    // Text of this profile, parsed back into the same values
+    std::string toString() const;
+
+    // Values separated by ","
+    static std::string join(const std::vector<int> &values);
+
+ private:
+    // Removes leading and trailing spaces
+    static std::string trim(const std::string &text);
+
+    // Parses values separated by "," (spaces allowed), returns false if any is not an integer
+    static bool parseValues(const std::string &text, std::vector<int> *values);
+};
+
+#endif  // INCLUDE_AI_PROFILE_H_
@@ -0,0 +1,100 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_RESULT_CACHE_H_
+#define INCLUDE_AI_RESULT_CACHE_H_
+
+#include <ai/transposition_table.h>
+#include <ai/utils.h>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Number of results kept by a default cache
+#define kRenjuAiResultCacheDefaultCapacity 4096
+
+// Bounded cache of search results, the least recently used result is dropped first.
+// Results are keyed by the canonical form of the game state (symmetric game states share
+// results), the player and the search parameters. A cache can be shared by multiple threads.
+class RenjuAIResultCache {
+ public:
+    explicit RenjuAIResultCache(size_t capacity = kRenjuAiResultCacheDefaultCapacity);
+    ~RenjuAIResultCache();
+
+    // Search parameters
+    struct Params {
+        int player;
+        int search_depth;
+        int time_limit;
+        int num_threads;
+        int profile;       // Serial number of the profile searched with (0: presets)
+    };
+
+    // A search result
+    struct Result {
+        int move_r, move_c;
+        int winning_player;
+        int actual_depth;
+        unsigned int node_count, eval_count, pm_count;
+    };
+
+    // Looks up the result of a search, the move is mapped to the orientation of gs.
+    // Returns false if not found.
+    bool lookup(const char *gs, int board_size, const Params &params, Result *result);
+
+    // Stores the result of a search
+    void store(const char *gs, int board_size, const Params &params, const Result &result);
+
+    // Removes all results, counters are kept
+    void clear();
+
+    // Statistics
+    size_t size() const;
+    size_t capacity() const { return max_size; }
+    uint64_t hits() const;
+    uint64_t misses() const;
+
+ private:
+    struct Item {
+        uint64_t key;
+        std::string state;    // Canonical game state (packed), to rule out hash collisions
+        Params params;
+        Result result;        // Move in the orientation of state
+    };
+
+    mutable std::mutex mutex;
+    size_t max_size;
+    uint64_t hit_count, miss_count;
+
+    // Items from most to least recently used, indexed by key
+    std::list<Item> items;
+    std::unordered_multimap<uint64_t, std::list<Item>::iterator> index;
+
+    uint64_t zobrist_1[kRenjuAiTTZobristSize];
+    uint64_t zobrist_2[kRenjuAiTTZobristSize];
+
+    // Computes the key and canonical state of a game state and parameters
+    uint64_t key(const char *gs, int board_size, const Params &params, std::string *state, int *symmetry) const;
+
+    // Finds an item, returns items.end() if not found
+    std::list<Item>::iterator find(uint64_t key, const std::string &state, const Params &params);
+};
+
+#endif  // INCLUDE_AI_RESULT_CACHE_H_
@@ -0,0 +1,169 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_SEARCH_CONTEXT_H_
+#define INCLUDE_AI_SEARCH_CONTEXT_H_
+
+#include <ai/phase_profiler.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Number of nodes between two deadline checks (power of 2)
+#define kRenjuAiSearchDeadlineInterval 256
+
+// Killer moves kept per ply
+#define kRenjuAiSearchKillerSlots 2
+
+// Levels of the preset search breadth
+#define kRenjuAiSearchBreadthLevels 5
+
+class RenjuAITranspositionTable;
+class RenjuAISearchSession;
+
+// Statistics of one iterative deepening pass (or of a fixed-depth search)
+struct RenjuAISearchIteration {
+    int depth;                    // Depth searched
+    bool completed;               // False if aborted at the deadline
+    int score;                    // Score of the best move
+    double time_ms;               // Wall time
+    unsigned int node_count;
+    unsigned int eval_count;
+    unsigned int beta_cutoffs;         // Nodes cut off by alpha-beta
+    unsigned int first_move_cutoffs;   // Cut-offs by the first searched move
+    unsigned int re_searches;          // Scouts searched again with a full window
+    int aspiration_fails;              // Root searches repeated outside the aspiration window
+    unsigned int tt_probes;
+    unsigned int tt_hits;
+    double tt_usage;              // Share of table entries written by this search (sampled)
+    double branching_factor;      // Effective branching factor
+    std::vector<std::pair<int, int>> pv;  // Principal variation (r, c), from the transposition table
+
+    // Rates (0 if nothing was counted)
+    double firstMoveCutoffRate() const {
+        return beta_cutoffs > 0 ? first_move_cutoffs / static_cast<double>(beta_cutoffs) : 0;
+    }
+    double ttHitRate() const {
+        return tt_probes > 0 ? tt_hits / static_cast<double>(tt_probes) : 0;
+    }
+};
+
+// State of a single search thread.
+// Searches with separate contexts can run concurrently in one process.
+class RenjuAISearchContext {
+ public:
+    explicit RenjuAISearchContext(int board_size);
+    ~RenjuAISearchContext();
+
+    // Board
+    int board_size;
+    unsigned int gs_size;
+
+    // Table shared by all threads of a search (nullptr: allocated per search)
+    RenjuAITranspositionTable *tt;
+
+    // Number of entries (log2) of a table allocated per search
+    int tt_size_log2;
+
+    // State kept from previous searches of the same game (nullptr: None),
+    // its table is used if tt is nullptr
+    RenjuAISearchSession *session;
+
+    // Moves searched per node from the root, each element for 2 plies and the last one repeated
+    // (empty: RenjuAINegamax presets). Values have to be at least 1.
+    std::vector<int> breadth;
+
+    // Lookup table of RenjuAIEval from RenjuAIEval::scoreTable (nullptr: presets)
+    const int *adm_scores;
+
+    // Moves (r, c) searched first while the search follows them from the root,
+    // continued from the principal variation of the previous search
+    std::vector<std::pair<int, int>> pv_hint;
+
+    // Move ordering: the last moves that caused a cut-off at each ply (cell index, -1: None)
+    // and the depth-weighted number of cut-offs caused by each cell, per player.
+    // Worker threads start with a copy of both.
+    std::vector<int> killers;
+    std::vector<unsigned int> history;
+
+    // Clears killer moves of at least plies plies
+    void resetKillers(int plies);
+
+    // Records a move causing a cut-off at a ply with a remaining depth
+    inline void addCutoff(int ply, int depth, int player, int r, int c) {
+        int index = board_size * r + c;
+        int *slots = &killers[kRenjuAiSearchKillerSlots * ply];
+        if (slots[0] != index) {
+            for (int i = kRenjuAiSearchKillerSlots - 1; i > 0; --i) slots[i] = slots[i - 1];
+            slots[0] = index;
+        }
+        history[gs_size * (player - 1) + index] += static_cast<unsigned int>(depth * depth);
+    }
+
+    // Time after which the search is aborted (time_point::max(): None)
+    std::chrono::steady_clock::time_point deadline;
+
+    // Stops the search when set by another thread (nullptr: None)
+    const std::atomic<bool> *stop;
+
+    // Set once the deadline has passed or stop is set, results of an aborted search are incomplete
+    bool aborted;
+
+    // Statistics
+    unsigned int node_count;
+    unsigned int eval_count;
+    unsigned int pm_count;
+    unsigned int beta_cutoffs;
+    unsigned int first_move_cutoffs;
+    unsigned int re_searches;
+    unsigned int tt_probes;
+    unsigned int tt_hits;
+    unsigned int threat_node_count;  // Moves made by RenjuAIThreatSolver
+    RenjuAIPhaseProfiler::Counters phases;  // Cycles of search phases (0 unless RenjuAIPhaseProfiler is enabled)
+
+    // Iterations of the last search
+    std::vector<RenjuAISearchIteration> iterations;
+
+    // Called on the searching thread after each completed iteration (nullptr: None)
+    std::function<void(const RenjuAISearchIteration &)> on_iteration;
+
+    // Resets statistics
+    void resetCounters();
+
+    // Adds statistics from another context (e.g. a worker thread)
+    void addCounters(const RenjuAISearchContext &other);
+
+    // Returns true if the search has to stop, the clock and the stop flag
+    // are read once every kRenjuAiSearchDeadlineInterval nodes
+    inline bool checkDeadline() {
+        if (aborted || (node_count & (kRenjuAiSearchDeadlineInterval - 1)) != 0) return aborted;
+        return checkClock();
+    }
+
+    // Same as above, reading the clock and the stop flag every time
+    inline bool checkClock() {
+        if (stop != nullptr && stop->load(std::memory_order_relaxed)) aborted = true;
+        if (deadline != std::chrono::steady_clock::time_point::max() &&
+            std::chrono::steady_clock::now() >= deadline) aborted = true;
+        return aborted;
+    }
+};
+
+#endif  // INCLUDE_AI_SEARCH_CONTEXT_H_
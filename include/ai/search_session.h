@@ -0,0 +1,86 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_SEARCH_SESSION_H_
+#define INCLUDE_AI_SEARCH_SESSION_H_
+
+#include <ai/search_context.h>
+#include <ai/transposition_table.h>
+#include <utility>
+#include <vector>
+
+// Search state kept between consecutive searches of one game (e.g. turns of a Gomocup match).
+// A session is used by one search at a time.
+class RenjuAISearchSession {
+ public:
+    explicit RenjuAISearchSession(int tt_size_log2 = kRenjuAiTTDefaultSizeLog2);
+    ~RenjuAISearchSession();
+
+    // Table used by searches of this session
+    RenjuAITranspositionTable tt;
+
+    // Last search: game state, deepest completed iteration, its time (ms) and principal variation (r, c)
+    int board_size;
+    int player;
+    int piece_count;
+    int depth;
+    double time_ms;
+    std::vector<std::pair<int, int>> pv;
+
+    // Move ordering tables of the last search
+    std::vector<int> killers;
+    std::vector<unsigned int> history;
+
+    // Returns the rest of the last principal variation if a game state follows its
+    // first two moves (the last best move and the expected reply), empty otherwise
+    std::vector<std::pair<int, int>> continuation(const char *gs, int board_size, int player) const;
+
+    // Records the result of a search
+    void update(const char *gs, int board_size, int player, int depth, double time_ms,
+                const std::vector<std::pair<int, int>> &pv);
+
+    // Copies move ordering tables into a context searching a game state.
+    // Killer moves are shifted by the two plies played since if the game followed
+    // the principal variation, history is kept with half its weight.
+    void restoreOrdering(RenjuAISearchContext *ctx, const char *gs, int player) const;
+
+    // Keeps move ordering tables of a finished search
+    void saveOrdering(const RenjuAISearchContext &ctx);
+
+    // Forgets everything (e.g. a new game)
+    void clear();
+
+    // Speculative searches (e.g. pondering on a predicted reply): the state is saved when one starts
+    // and restored at its end unless kept, so that a search of a position that never happened
+    // leaves no results or ordering tables behind. Entries of the table are always kept.
+    void beginSpeculation();
+    void endSpeculation(bool keep);
+
+ private:
+    // State saved by beginSpeculation
+    bool speculating;
+    int saved_board_size, saved_player, saved_piece_count, saved_depth;
+    double saved_time_ms;
+    std::vector<std::pair<int, int>> saved_pv;
+    std::vector<int> saved_killers;
+    std::vector<unsigned int> saved_history;
+
+    static int countPieces(const char *gs, int board_size);
+};
+
+#endif  // INCLUDE_AI_SEARCH_SESSION_H_
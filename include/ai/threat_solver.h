@@ -0,0 +1,117 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_THREAT_SOLVER_H_
+#define INCLUDE_AI_THREAT_SOLVER_H_
+
+#include <ai/bitboard.h>
+#include <ai/board.h>
+#include <ai/search_context.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Maximum number of attacking moves in a sequence
+#define kRenjuAiThreatSolverVCFDepth 16
+#define kRenjuAiThreatSolverVCTDepth 6
+
+// Moves made by each stage before it gives up
+#define kRenjuAiThreatSolverVCFBudget 20000
+#define kRenjuAiThreatSolverVCTBudget 20000
+
+// Proves forcing wins: continuous fours (VCF), then fours and threes (VCT).
+// Only proven wins are reported, positions are not evaluated otherwise.
+// The solver gives up at the deadline or stop flag of the search context.
+// A three is a move after which the attacker can make four with two ways to complete five
+// on the same line, the defender may answer with any cell on the lines of the three or
+// make a four anywhere, other answers cannot stop the next four.
+class RenjuAIThreatSolver {
+ public:
+    RenjuAIThreatSolver();
+    ~RenjuAIThreatSolver();
+
+    // Searches a forcing win of player (to move) in the current state of board.
+    // Returns true and the sequence (r, c) of both players, starting with the winning move.
+    static bool solve(RenjuAISearchContext *ctx, const RenjuAIBoard &board, int player,
+                      std::vector<std::pair<int, int>> *sequence);
+
+ private:
+    // Game state of a solver stage
+    struct State {
+        State(RenjuAISearchContext *ctx, const RenjuAIBoard &board);
+
+        RenjuAISearchContext *ctx;
+        int board_size;
+        RenjuAIBitboard bits;
+        std::vector<char> cells;
+
+        // Moves made, the limit and when the clock is read next
+        int node_count;
+        int budget;
+        int next_check;
+
+        // Returns true once the budget is used up or the search is aborted
+        inline bool exhausted() {
+            if (node_count >= next_check) {
+                next_check = node_count + kRenjuAiSearchDeadlineInterval;
+                if (ctx->checkClock()) budget = 0;
+            }
+            return node_count >= budget;
+        }
+
+        inline char cell(int r, int c) const { return cells[board_size * r + c]; }
+        inline void set(int r, int c, int player) {
+            cells[board_size * r + c] = static_cast<char>(player);
+            bits.setCell(r, c, player);
+        }
+    };
+
+    // Searches a win of player with at most depth attacking moves.
+    // A forced move (-1: None) blocks a five of the opponent and has to make a four.
+    static bool attack(State *s, const uint32_t *candidates, int player, int depth, bool threes,
+                       int forced, std::vector<std::pair<int, int>> *sequence);
+
+    // Returns true if all answers to a three at (r, c) lose
+    static bool defendThree(State *s, const uint32_t *candidates, int player, int depth, int r, int c,
+                            std::vector<std::pair<int, int>> *sequence);
+
+    // Returns true if a piece of player at the empty cell (r, c) makes 5 or more in a row
+    static inline bool makesFive(const State &s, int player, int r, int c) {
+        for (int o = 0; o < 4; ++o) {
+            if (__builtin_ctz(~s.bits.forward(player, o, r, c)) +
+                __builtin_ctz(~s.bits.backward(player, o, r, c)) >= 4) return true;
+        }
+        return false;
+    }
+
+    // Returns true if player has at least count pieces within 4 cells on a line through (r, c)
+    static bool hasPieces(const State &s, int player, int r, int c, int count);
+
+    // Writes up to 2 empty cells within 4 cells on the lines through (r, c) where player
+    // makes five and returns their number (at most 2 are counted).
+    // Only the line of orientation is searched if it is not -1.
+    static int fiveCells(const State &s, int player, int r, int c, int orientation, int *cells);
+
+    // Returns true if a piece of player at (r, c) makes a three (see above)
+    static bool isThree(State *s, int player, int r, int c);
+
+    // Adds the cells within 2 cells of (r, c) to candidates
+    static void addCandidates(const State &s, int r, int c, uint32_t *candidates);
+};
+
+#endif  // INCLUDE_AI_THREAT_SOLVER_H_
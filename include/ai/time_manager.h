@@ -0,0 +1,71 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_TIME_MANAGER_H_
+#define INCLUDE_AI_TIME_MANAGER_H_
+
+#include <ai/eval.h>
+#include <ai/search_context.h>
+#include <vector>
+
+// Branching factor per ply assumed before any iteration has measured one
+#define kRenjuAiTimeDefaultBranchingFactor 3
+
+// Moves a match time is expected to last for, at most half the empty cells
+#define kRenjuAiTimeMovesToGo 25
+
+// Time (ms) kept for writing the move and process overhead, at most a tenth of a turn
+#define kRenjuAiTimeOverhead 30
+
+// Share of the time limit an iteration may end at, per iteration the best move did not change.
+// An iteration that changed the best move may use the whole limit.
+#define kRenjuAiTimeStableScale 0.2
+#define kRenjuAiTimeMinimumScale 0.4
+
+// Iterative deepening stops once a win is found with this score
+#define kRenjuAiTimeDecidedScore (kRenjuAiEvalWinningScore / 4)
+
+// Allocates search time: the time of a turn from turn and match limits, and whether
+// iterative deepening starts another iteration within it
+class RenjuAITimeManager {
+ public:
+    RenjuAITimeManager();
+    ~RenjuAITimeManager();
+
+    // Time limit (ms) of a turn. timeout_turn is the limit of each turn (0: as fast as possible,
+    // negative: None), time_left the time left in the match (negative: no match limit).
+    // 0 is returned for a single iteration without deadline.
+    static int turnTime(int timeout_turn, int time_left, int board_size, int piece_count);
+
+    // Returns true if the next iteration is expected to end within the time limit.
+    // Its time is predicted from the last completed iteration and the effective branching factor
+    // of recent iterations. The limit is shortened while the best move stays the same,
+    // a single possible move or a found win end the search.
+    static bool nextIteration(const std::vector<RenjuAISearchIteration> &iterations, double elapsed_ms,
+                              int time_limit);
+
+    // Returns true if iterative deepening can start at an iteration the previous turn already searched
+    // 2 plies deeper, in previous_ms. The start is expected to take at most as long and has to end within
+    // the time limit, a search without time limit always can.
+    static bool continueDeep(double previous_ms, double elapsed_ms, int time_limit);
+
+    // Effective branching factor per ply of the last two iterations that measured one
+    static double branchingFactor(const std::vector<RenjuAISearchIteration> &iterations);
+};
+
+#endif  // INCLUDE_AI_TIME_MANAGER_H_
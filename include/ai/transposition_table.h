@@ -0,0 +1,143 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_AI_TRANSPOSITION_TABLE_H_
+#define INCLUDE_AI_TRANSPOSITION_TABLE_H_
+
+#include <ai/utils.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Number of entries (log2) in a default transposition table
+#define kRenjuAiTTDefaultSizeLog2 18
+
+// Entries of a bucket, a bucket fills one cache line and is probed at once
+#define kRenjuAiTTBucketSlots 4
+#define kRenjuAiTTCacheLine 64
+
+// Replacing an entry of a previous search costs as much as this many plies of depth
+#define kRenjuAiTTAgeWeight 4
+
+// Buckets sampled to estimate the usage of a table
+#define kRenjuAiTTUsageSample 1000
+
+// Tables at least this large are cleared by several threads (bytes per thread)
+#define kRenjuAiTTClearChunk (16 << 20)
+
+// Zobrist keys cover the largest supported board (20 x 20)
+#define kRenjuAiTTZobristSize 400
+
+// Bound types of a stored score
+#define kRenjuAiTTBoundExact 0
+#define kRenjuAiTTBoundLower 1
+#define kRenjuAiTTBoundUpper 2
+
+// A transposition table can be shared by multiple search threads.
+// Entries are written without locks, a torn entry fails its key check.
+// Memory is mapped with huge pages where available and first touched by clearing threads,
+// so that a large table is spread over the memory of all NUMA nodes the threads run on.
+class RenjuAITranspositionTable {
+ public:
+    explicit RenjuAITranspositionTable(int size_log2 = kRenjuAiTTDefaultSizeLog2);
+    ~RenjuAITranspositionTable();
+
+    // Number of entries (log2) of the largest table within a memory size, at least one bucket
+    static int sizeLog2(size_t megabytes);
+
+    // Memory of a table with a number of entries (log2)
+    static size_t memoryBytes(int size_log2);
+
+    // A single table entry
+    struct Entry {
+        uint64_t key;         // Zobrist hash of the game state
+        int score;            // Score returned by the search
+        char depth;           // Remaining depth the score was searched with
+        char bound;           // kRenjuAiTTBound*
+        char player;          // Player to move
+        char move_r;          // Best move (-1: None)
+        char move_c;
+    };
+
+    // Zobrist keys of this table
+    uint64_t zobrist_1[kRenjuAiTTZobristSize];
+    uint64_t zobrist_2[kRenjuAiTTZobristSize];
+
+    // Looks up a game state, returns false if not found
+    bool probe(uint64_t key, int player, Entry *entry) const;
+
+    // Stores a search result, deeper results of the same state are kept
+    void store(uint64_t key, int player, int depth, int bound, int score, int move_r, int move_c);
+
+    // Same as above keyed by the canonical hash, symmetric game states share entries.
+    // Moves are stored in the orientation of the canonical hash and mapped back when found.
+    bool probe(const RenjuAIUtils::SymmetricHash &hash, int player, Entry *entry) const;
+    void store(const RenjuAIUtils::SymmetricHash &hash, int player, int depth, int bound, int score,
+               int move_r, int move_c);
+
+    // Removes all entries
+    void clear();
+
+    // Replaces the table by an empty one with a number of entries (log2), keys are kept
+    void resize(int size_log2);
+
+    // Starts a search, entries of previous searches are replaced first
+    void newSearch();
+
+    // Makes entries of previous searches misses, e.g. for unrelated positions of a batch.
+    // Generations wrap after 64 searches, the table is cleared then.
+    void isolateSearches(bool isolate);
+
+    // Statistics: memory allocated, whether huge pages back the table (reserved or transparent ones requested)
+    // and the share of entries written by the current search
+    size_t memoryBytes() const;
+    bool hugePages() const;
+    double usage() const;
+
+ private:
+    // Stores key ^ data along with data so that a slot written
+    // by two threads at the same time never matches a key
+    struct Slot {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+
+    // Slots sharing a cache line
+    struct alignas(kRenjuAiTTCacheLine) Bucket {
+        Slot slots[kRenjuAiTTBucketSlots];
+    };
+
+    Bucket *buckets;
+    uint64_t mask;           // Bucket of a key
+    size_t bytes;
+    bool huge_pages;
+    bool isolated;
+    std::atomic<unsigned int> generation;
+
+    // Maps and releases memory of the buckets
+    void allocate(int size_log2);
+    void release();
+
+    // Packs an entry into 64 bits
+    static uint64_t pack(int score, int depth, int bound, int player, int move_r, int move_c,
+                         unsigned int generation);
+    static void unpack(uint64_t data, Entry *entry);
+    static unsigned int entryGeneration(uint64_t data);
+};
+
+#endif  // INCLUDE_AI_TRANSPOSITION_TABLE_H_
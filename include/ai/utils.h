@@ -19,28 +19,59 @@
 #ifndef INCLUDE_AI_UTILS_H_
 #define INCLUDE_AI_UTILS_H_
 
-#include <utils/globals.h>
+#include <cstdint>
+
+// Number of symmetries of a square board (rotations and reflections)
+#define kRenjuAiUtilsSymmetries 8
 
 class RenjuAIUtils {
  public:
     RenjuAIUtils();
     ~RenjuAIUtils();
 
-    static inline char getCell(const char *gs, int r, int c) {
-        if (r < 0 || r >= g_board_size || c < 0 || c >= g_board_size) return -1;
-        return gs[g_board_size * r + c];
+    // Board size of a kernel specialised for kBoardSize.
+    // Kernels are instantiated for 15 and 19 (Gomocup and CLI defaults), with 0 they read board_size.
+    template <int kBoardSize>
+    static inline int boardSize(int board_size) { return kBoardSize > 0 ? kBoardSize : board_size; }
+
+    static inline char getCell(const char *gs, int board_size, int r, int c) {
+        if (r < 0 || r >= board_size || c < 0 || c >= board_size) return -1;
+        return gs[board_size * r + c];
     }
 
-    static inline bool setCell(char *gs, int r, int c, char value) {
-        if (r < 0 || r >= g_board_size || c < 0 || c >= g_board_size) return false;
-        gs[g_board_size * r + c] = value;
+    static inline bool setCell(char *gs, int board_size, int r, int c, char value) {
+        if (r < 0 || r >= board_size || c < 0 || c >= board_size) return false;
+        gs[board_size * r + c] = value;
         return true;
     }
 
-    static bool remoteCell(const char *gs, int r, int c);
+    static bool remoteCell(const char *gs, int board_size, int r, int c);
+
+    // Whether a piece of player at (r, c) makes 5 or more in a row, the cell itself is not read.
+    static bool completesFive(const char *gs, int board_size, int r, int c, int player);
+
+    // Maps a cell by one of the board symmetries (0: Identity).
+    // Bit 2 of symmetry transposes the board, then bit 0 flips rows and bit 1 flips columns.
+    static inline void symmetricCell(int board_size, int symmetry, int r, int c, int *sr, int *sc) {
+        if (symmetry & 4) { int t = r; r = c; c = t; }
+        if (symmetry & 1) r = board_size - 1 - r;
+        if (symmetry & 2) c = board_size - 1 - c;
+        *sr = r; *sc = c;
+    }
+
+    // Reverts symmetricCell
+    static inline void inverseSymmetricCell(int board_size, int symmetry, int sr, int sc, int *r, int *c) {
+        if (symmetry & 1) sr = board_size - 1 - sr;
+        if (symmetry & 2) sc = board_size - 1 - sc;
+        if (symmetry & 4) { int t = sr; sr = sc; sc = t; }
+        *r = sr; *c = sc;
+    }
 
     // Game state hashing
     static void zobristInit(int size, uint64_t *z1, uint64_t *z2);
+
+    // Same as above with keys that only depend on seed, for hashes stored in files
+    static void zobristInit(int size, uint64_t *z1, uint64_t *z2, uint64_t seed);
     static uint64_t zobristHash(const char *gs, int size, uint64_t *z1, uint64_t *z2);
     static inline void zobristToggle(uint64_t *state, uint64_t *z1, uint64_t *z2,
                                      int row_size, int r, int c, int player) {
@@ -51,6 +82,51 @@ class RenjuAIUtils {
         }
     }
 
+    // Zobrist hashes of a game state in every symmetry, maintained incrementally.
+    // The smallest one, the canonical hash, is the same for all symmetric game states.
+    struct SymmetricHash {
+        uint64_t keys[kRenjuAiUtilsSymmetries];
+        int board_size;
+
+        // Returns the canonical hash and the symmetry it was computed with.
+        // Moves of that symmetric game state are mapped back with inverseSymmetricCell.
+        inline uint64_t canonical(int *symmetry) const {
+            int best = 0;
+            for (int s = 1; s < kRenjuAiUtilsSymmetries; ++s)
+                if (keys[s] < keys[best]) best = s;
+            if (symmetry != nullptr) *symmetry = best;
+            return keys[best];
+        }
+    };
+
+    static void zobristHash(const char *gs, int board_size, const uint64_t *z1, const uint64_t *z2,
+                            SymmetricHash *hash);
+    template <int kBoardSize = 0>
+    static inline void zobristToggle(SymmetricHash *hash, const uint64_t *z1, const uint64_t *z2,
+                                     int r, int c, int player) {
+        const uint64_t *z = player == 1 ? z1 : z2;
+        int size = boardSize<kBoardSize>(hash->board_size), n = size - 1;
+
+        // Cells of all symmetries, in symmetricCell order
+        int cells[kRenjuAiUtilsSymmetries] = {
+            size * r + c,       size * (n - r) + c,
+            size * r + n - c,   size * (n - r) + n - c,
+            size * c + r,       size * (n - c) + r,
+            size * c + n - r,   size * (n - c) + n - r};
+        for (int s = 0; s < kRenjuAiUtilsSymmetries; ++s) hash->keys[s] ^= z[cells[s]];
+    }
+
+    // Maps a game state by a symmetry
+    static void symmetricState(const char *gs, int board_size, int symmetry, char *result);
+
+    // Bytes of a game state packed with 2 bits per cell, from the high bits of each byte
+    static inline int packedSize(int board_size) { return (board_size * board_size + 3) / 4; }
+
+    // Packs a game state into packedSize(board_size) bytes
+    static void packState(const char *gs, int board_size, uint8_t *packed);
+
+    // Reverts packState, returns false if a cell is not 0, 1 or 2
+    static bool unpackState(const uint8_t *packed, int board_size, char *gs);
 };
 
 #endif  // INCLUDE_AI_UTILS_H_
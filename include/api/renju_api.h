@@ -19,25 +19,190 @@
 #ifndef INCLUDE_API_RENJU_API_H_
 #define INCLUDE_API_RENJU_API_H_
 
+#include <ai/phase_profiler.h>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
 #include <string>
+#include <vector>
+
+// Positions read ahead of the oldest unfinished one, per worker
+#define kRenjuAPIBatchWindow 4
+
+// Game state formats, all accepted wherever a game state string is:
+//   One digit per cell ('0': empty, '1': black, '2': white), row by row
+//   kRenjuAPIPackedPrefix and a base64url digit per 3 cells (2 bits each, the first in the high bits)
+//   kRenjuAPIMovesPrefix and the moves played from black on, each as column and row letters ('a': 0)
+#define kRenjuAPIPackedPrefix "p:"
+#define kRenjuAPIMovesPrefix "m:"
+
+class RenjuAIOpeningBook;
+class RenjuAIProfile;
+class RenjuAIResultCache;
+class RenjuAISearchContext;
+class RenjuAISearchSession;
+class RenjuAITranspositionTable;
+struct RenjuAISearchIteration;
 
 class RenjuAPI {
  public:
     RenjuAPI();
     ~RenjuAPI();
 
+    // Best move of a search so far, reported after each completed iteration of iterative deepening
+    struct Progress {
+        int depth = 0;
+        int move_r = -1, move_c = -1;
+        int score = 0;
+        unsigned int node_count = 0;  // Nodes searched since the search started
+        double time_ms = 0;           // Wall time since the search started
+    };
+    typedef std::function<void(const Progress &)> ProgressCallback;
+
+    // Stops searches it is passed to when cancelled from any thread, copies share the same state
+    class CancellationToken {
+     public:
+        CancellationToken() : cancelled_flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+        void cancel() { cancelled_flag->store(true); }
+        bool cancelled() const { return cancelled_flag->load(); }
+
+        // Stop flag of generateMove
+        const std::atomic<bool> *flag() const { return cancelled_flag.get(); }
+
+     private:
+        std::shared_ptr<std::atomic<bool>> cancelled_flag;
+    };
+
+    // Result of generateMoveAsync (valid if success is true)
+    struct MoveResult {
+        bool success = false;
+        bool cancelled = false;  // Ended by the token, the move is the best one found until then
+        int actual_depth = 0, move_r = -1, move_c = -1, winning_player = 0;
+        unsigned int node_count = 0, eval_count = 0, pm_count = 0;
+    };
+
     // Generate move based on a given game state
-    static bool generateMove(const char *gs_string, int ai_player_id,
+    // Each call searches independently, calls from multiple threads can run concurrently.
+    static bool generateMove(const char *gs_string, int board_size, int ai_player_id,
                              int search_depth, int time_limit, int num_threads,
                              int *actual_depth, int *move_r, int *move_c, int *winning_player,
                              unsigned int *node_count, unsigned int *eval_count, unsigned int *pm_count);
 
-    // Convert a game state string to game state binary array
-    static void gsFromString(const char *gs_string, char *gs);
+    // Same as above, searching with a transposition table kept by the caller (e.g. between requests).
+    // A table can be shared by concurrent calls.
+    // Statistics of each iterative deepening pass are written to iterations if given.
+    // The search ends early once stop is set by another thread, as if the time limit was reached.
+    // A session continues the previous search of the same game, its table is used if tt is nullptr.
+    // progress is called on the searching thread after each completed iteration if given.
+    // Cycles of search phases of all threads are written to phases if given (RenjuAIPhaseProfiler).
+    static bool generateMove(RenjuAITranspositionTable *tt, const char *gs_string, int board_size, int ai_player_id,
+                             int search_depth, int time_limit, int num_threads,
+                             int *actual_depth, int *move_r, int *move_c, int *winning_player,
+                             unsigned int *node_count, unsigned int *eval_count, unsigned int *pm_count,
+                             std::vector<RenjuAISearchIteration> *iterations = nullptr,
+                             const std::atomic<bool> *stop = nullptr,
+                             RenjuAISearchSession *session = nullptr,
+                             const ProgressCallback &progress = nullptr,
+                             RenjuAIPhaseProfiler::Counters *phases = nullptr);
+
+    // Same as above on a thread of its own, returns at once. The game state is copied,
+    // tt and session (both optional) have to outlive the search.
+    // Cancelling the token ends the search with the best move found so far and frees its threads,
+    // e.g. once the client of a server is gone.
+    static std::future<MoveResult> generateMoveAsync(const std::string &gs_string, int board_size, int ai_player_id,
+                                                     int search_depth, int time_limit, int num_threads,
+                                                     const ProgressCallback &progress,
+                                                     const CancellationToken &cancel,
+                                                     RenjuAITranspositionTable *tt = nullptr,
+                                                     RenjuAISearchSession *session = nullptr);
+
+    // Same as generateMove, answered from a result cache if the game state (or a symmetric one) was searched
+    // with the same parameters. New results are stored in the cache unless stopped. cache_hit is set if given,
+    // iterations are left empty and phases zero for a cached result.
+    static bool generateMoveCached(RenjuAIResultCache *cache, RenjuAITranspositionTable *tt, const char *gs_string,
+                                   int board_size, int ai_player_id, int search_depth, int time_limit,
+                                   int num_threads, int *actual_depth, int *move_r, int *move_c,
+                                   int *winning_player, unsigned int *node_count, unsigned int *eval_count,
+                                   unsigned int *pm_count, bool *cache_hit,
+                                   std::vector<RenjuAISearchIteration> *iterations = nullptr,
+                                   const std::atomic<bool> *stop = nullptr,
+                                   const ProgressCallback &progress = nullptr,
+                                   RenjuAIPhaseProfiler::Counters *phases = nullptr);
+
+    // Looks up the move of ai_player_id in an opening book,
+    // returns false if the input is invalid or the game state is not in the book
+    static bool bookMove(const RenjuAIOpeningBook *book, const char *gs_string, int board_size, int ai_player_id,
+                         int *move_r, int *move_c);
+
+    // A position analysed by generateMoves and its result
+    struct BatchItem {
+        std::string gs_string;
+        int ai_player_id = 1;
+
+        // Results (valid if success is true)
+        bool success = false;
+        int actual_depth = 0, move_r = -1, move_c = -1, winning_player = 0;
+        unsigned int node_count = 0, eval_count = 0, pm_count = 0;
+        RenjuAIPhaseProfiler::Counters phases = {};
+    };
+
+    // Analyses a stream of positions on num_workers threads, each position is searched on one thread.
+    // next() fills the next item and returns false at the end of the stream, done() receives
+    // results in input order. Neither is called concurrently.
+    // Each worker reuses its search context and transposition table between positions,
+    // tables of all workers together take the memory set by setTableSize.
+    static void generateMoves(int board_size, int search_depth, int time_limit, int num_workers,
+                              const std::function<bool(BatchItem *)> &next,
+                              const std::function<void(const BatchItem &)> &done);
+
+    // Same as above for positions in memory, results are written into items
+    static void generateMoves(std::vector<BatchItem> *items, int board_size, int search_depth, int time_limit,
+                              int num_workers);
+
+    // Selects the profile of all following searches, e.g. once at startup.
+    // Returns false and keeps the current profile if it is invalid, error is set if given.
+    // Results cached with a previous profile are not returned for the new one.
+    static bool setProfile(const RenjuAIProfile &profile, std::string *error = nullptr);
+
+    // Profile of searches (the "default" profile unless set)
+    static RenjuAIProfile profile();
+
+    // Memory of each transposition table allocated by following searches in megabytes, rounded down
+    // to a power of 2 (0: default size). Tables passed in by the caller keep their size.
+    static void setTableSize(size_t megabytes);
+    static size_t tableSize();
+
+    // Number of entries (log2) of such tables
+    static int tableSizeLog2();
+
+    // Convert a game state string in any of the formats above to game state binary array,
+    // returns false if the string is not a valid game state of the board size
+    static bool gsFromString(const char *gs_string, int board_size, char *gs);
+
+    // Encodes a game state binary array in the packed format
+    static std::string gsToPacked(const char *gs, int board_size);
 
  private:
+    // Checks arguments of generateMove
+    static bool validInput(const char *gs_string, int board_size, int ai_player_id,
+                           int search_depth, int time_limit, int num_threads);
+
+    // Makes a search use the current profile if ctx is given, returns the serial number of the profile
+    static int applyProfile(RenjuAISearchContext *ctx);
+
+    // Searches a batch item with a worker's context and game state buffer
+    static void searchBatchItem(RenjuAISearchContext *ctx, char *gs, int search_depth, int time_limit,
+                                BatchItem *item);
+
     // Render game state into text
-    static std::string renderGameState(const char *gs);
+    static std::string renderGameState(const char *gs, int board_size);
+
+    // Digits of the packed format
+    static const char kPackedDigits[65];
+    static int packedDigitValue(char digit);
 };
 
 #endif  // INCLUDE_API_RENJU_API_H_
@@ -0,0 +1,44 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_PROTOCOLS_BATCH_H_
+#define INCLUDE_PROTOCOLS_BATCH_H_
+
+#include <api/renju_api.h>
+#include <string>
+
+// Offline analysis of many positions, one per line on stdin:
+//   <state> [<ai_player>]
+// Positions are spread across -t worker threads. Each position is answered
+// with one line in the same format as the CLI protocol, in input order.
+// Searches use the profile given with -c.
+class RenjuProtocolBatch {
+ public:
+    RenjuProtocolBatch();
+    ~RenjuProtocolBatch();
+
+    static bool beginSession(int argc, char const *argv[]);
+
+    // Parses an input line, returns false if it is malformed
+    static bool parseLine(const std::string &line, RenjuAPI::BatchItem *item);
+
+    // Generates the response line of an analysed item
+    static std::string generateResultJson(const RenjuAPI::BatchItem &item);
+};
+
+#endif  // INCLUDE_PROTOCOLS_BATCH_H_
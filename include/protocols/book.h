@@ -0,0 +1,53 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_PROTOCOLS_BOOK_H_
+#define INCLUDE_PROTOCOLS_BOOK_H_
+
+#include <ai/opening_book.h>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Opening book generation:
+//   gomoku book -o <file> [-b <board_size>] [-n <stones>] [-d <depth>] [-t <workers>]
+// The first move is in the center. From there, every reply next to a stone is
+// expanded for both colours and the book move of each state with up to -n stones
+// is searched at depth -d.
+class RenjuProtocolBook {
+ public:
+    RenjuProtocolBook();
+    ~RenjuProtocolBook();
+
+    static bool beginSession(int argc, char const *argv[]);
+
+    // Generates the entries of a book
+    static std::vector<RenjuAIOpeningBook::Entry> generate(int board_size, int max_stones, int search_depth,
+                                                           int num_workers);
+
+ private:
+    // Adds the states after each reply next to a stone of state to states,
+    // states with more than max_stones or already seen are skipped
+    static void expand(const std::string &state, int board_size, int max_stones,
+                       std::unordered_set<uint64_t> *seen, std::vector<std::string> *states);
+
+    // Player to move in a state
+    static int playerToMove(const std::string &state);
+};
+
+#endif  // INCLUDE_PROTOCOLS_BOOK_H_
@@ -19,8 +19,15 @@
 #ifndef INCLUDE_PROTOCOLS_CLI_H_
 #define INCLUDE_PROTOCOLS_CLI_H_
 
+#include <api/renju_api.h>
+#include <atomic>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+class RenjuAIOpeningBook;
+class RenjuAIResultCache;
+class RenjuAITranspositionTable;
 
 class RenjuProtocolCLI {
  public:
@@ -30,20 +37,43 @@ class RenjuProtocolCLI {
     static bool beginSession(int argc, char const *argv[]);
 
     // Generate move and responds in json
-    static std::string generateMove(const char *gs_string, int ai_player_id, int search_depth,
-                                    int time_limit, int num_threads);
+    // tt is an optional transposition table kept between calls,
+    // the move is taken from book (if given) when the game state is found,
+    // then from cache (if given) when the game state was searched with the same parameters.
+    // The search ends early once stop is set ("cancelled": "1"), progress is passed on to RenjuAPI.
+    static std::string generateMove(RenjuAITranspositionTable *tt, const char *gs_string, int ai_player_id,
+                                    int search_depth, int time_limit, int num_threads,
+                                    const RenjuAIOpeningBook *book = nullptr, RenjuAIResultCache *cache = nullptr,
+                                    const std::atomic<bool> *stop = nullptr,
+                                    const RenjuAPI::ProgressCallback &progress = nullptr);
+
+    // Generate json response
+    static std::string generateResultJson(const std::unordered_map<std::string, std::string> *data,
+                                          const std::string &message);
+
+    // Selects the profile of searches by built-in name or file (RenjuAIProfile),
+    // returns false and writes the reason to stderr if it can not be loaded or is invalid
+    static bool selectProfile(const char *name_or_path);
+
+    // Adds the name and values of the current profile to a result map
+    static void addProfile(std::unordered_map<std::string, std::string> *data);
+
+    // Sets the memory of transposition tables in megabytes (RenjuAPI::setTableSize),
+    // returns false and keeps the current size if it is not a positive number
+    static bool selectTableSize(const char *megabytes);
+
+    // Adds memory, hit rate and usage of a table (if given) searched by iterations to a result map
+    static void addTableStats(const RenjuAITranspositionTable *tt,
+                              const std::vector<RenjuAISearchIteration> &iterations,
+                              std::unordered_map<std::string, std::string> *data);
 
- private:
     // Validates a string and parses into an integer
     static bool parseIntegerArgument(const char *str, int max_length, int *result);
 
+ private:
     // Validates a string and returns the length.
     // If fails validation, -1 is returned.
     static int validateString(const char *str, int max_length);
-
-    // Generate json response
-    static std::string generateResultJson(const std::unordered_map<std::string, std::string> *data,
-                                          const std::string &message);
 };
 
 #endif  // INCLUDE_PROTOCOLS_CLI_H_
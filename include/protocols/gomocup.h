@@ -19,8 +19,26 @@
 #ifndef INCLUDE_PROTOCOLS_GOMOCUP_H_
 #define INCLUDE_PROTOCOLS_GOMOCUP_H_
 
+#include <ai/phase_profiler.h>
+#include <ai/search_context.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+class RenjuAIOpeningBook;
+class RenjuAISearchSession;
+
+// Gomocup (Piskvork) protocol. The session keeps search state between turns
+// (transposition table, depth and principal variation).
+// With pondering enabled ("pbrain-blupig -ponder" or "INFO ponder 1"), the state after
+// the predicted opponent move is searched while the opponent thinks.
+// Moves found in the opening book ("blupig.book" next to the executable, or "-book <path>")
+// are played without searching. Searches use the RenjuAIProfile given with "-profile <name or path>".
+// Turns are searched for the turn limit or a share of the match time left, whichever is shorter
+// ("INFO timeout_turn", "INFO timeout_match", "INFO time_left").
 class RenjuProtocolGomocup {
  public:
     RenjuProtocolGomocup();
@@ -29,7 +47,52 @@ class RenjuProtocolGomocup {
     static bool beginSession(int argc, char const *argv[]);
 
  private:
-    static void performAndWriteMove(char *gs_string, int time_limit);
+    // Result of a search
+    struct SearchResult {
+        bool success = false;
+        bool book_move = false;
+        int actual_depth = 0, move_r = -1, move_c = -1, winning_player = 0;
+        unsigned int node_count = 0, eval_count = 0;
+        std::vector<RenjuAISearchIteration> iterations;
+        RenjuAIPhaseProfiler::Counters phases = {};
+    };
+
+    // A search running in the background on the state after the predicted opponent move
+    struct Ponder {
+        std::thread thread;
+        std::atomic<bool> stop{false};
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool finished = false;
+        int predicted_r = -1, predicted_c = -1;
+        std::string gs_string;
+        SearchResult result;
+        RenjuAISearchSession *session = nullptr;
+    };
+
+    static void search(const RenjuAIOpeningBook *book, RenjuAISearchSession *session, const char *gs_string,
+                       int board_size, int time_limit, const std::atomic<bool> *stop, SearchResult *result);
+    static void writeMove(char *gs_string, int board_size, const SearchResult &result);
+    static void performAndWriteMove(const RenjuAIOpeningBook *book, RenjuAISearchSession *session, char *gs_string,
+                                    int board_size, int time_limit, SearchResult *result);
+
+    // Starts pondering on the opponent move predicted by the last search
+    static void startPonder(Ponder *ponder, const RenjuAIOpeningBook *book, RenjuAISearchSession *session,
+                            const char *gs_string, int board_size, const SearchResult &last);
+
+    // Stops pondering and discards the result
+    static void stopPonder(Ponder *ponder);
+
+    // Lets a ponder search on the actual state continue until the time limit, then writes its move
+    static void finishPonder(Ponder *ponder, char *gs_string, int board_size, int time_limit,
+                             std::chrono::steady_clock::time_point turn_start, SearchResult *result);
+
+    // Time limit (ms) of the next search, time_left < 0 if the match is not limited
+    static int turnTime(const char *gs_string, int board_size, int timeout_turn, int time_left);
+
+    // Subtracts the time since the start of a turn from the match time left
+    static void spendTime(int *time_left, std::chrono::steady_clock::time_point turn_start);
+
     static void splitLine(const char *line, int *output);
     static void writeStdout(std::string str);
 };
@@ -0,0 +1,56 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INCLUDE_PROTOCOLS_SERVER_H_
+#define INCLUDE_PROTOCOLS_SERVER_H_
+
+#include <atomic>
+#include <functional>
+#include <string>
+
+class RenjuAIResultCache;
+class RenjuAITranspositionTable;
+
+// Long-running engine reading one JSON request per line from stdin:
+//   {"id": 1, "s": "<state>", "p": 2, "d": -1, "l": 5500, "t": 1}
+// States are in any of the RenjuAPI formats (digits, "p:" packed or "m:" moves).
+// Each request is answered with one line, in the same format
+// as the CLI protocol, plus the "id" of the request if given.
+// Requests are searched concurrently and share a transposition table.
+// Results are cached, a request searched before (or a symmetric one) is answered with
+// "cache_hit": "1" without searching. {"id": 1, "stats": 1} returns cache statistics.
+// Searches use the profile given with "gomoku serve -c <profile>".
+// With "progress": 1 the best move so far is sent after each iteration of the search, as lines
+// with "message": "progress" and the "id" of the request. {"cancel": 1} ends the searches of
+// requests with "id": 1, they are answered with their best move so far and "cancelled": "1".
+// Searches still running when the input ends are cancelled.
+class RenjuProtocolServer {
+ public:
+    RenjuProtocolServer();
+    ~RenjuProtocolServer();
+
+    static bool beginSession(int argc, char const *argv[]);
+
+    // Generate move for a single request line and responds in json, cache is optional.
+    // The search ends early once stop is set, progress lines are passed to write_progress if given.
+    static std::string handleRequest(RenjuAITranspositionTable *tt, RenjuAIResultCache *cache,
+                                     const std::string &line, const std::atomic<bool> *stop = nullptr,
+                                     const std::function<void(const std::string &)> &write_progress = nullptr);
+};
+
+#endif  // INCLUDE_PROTOCOLS_SERVER_H_
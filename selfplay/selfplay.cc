@@ -0,0 +1,345 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Engine versus engine matches between two search configurations.
+//
+// Usage: gomoku_selfplay [-A <config>] [-B <config>] [-n <games>] [-j <parallel_games>]
+//                        [-b <board_size>] [-m <opening_moves>] [-s <seed>] [-o <summary.json>]
+//
+// A config is a comma separated list of d:<depth> (-1: iterative deepening), l:<time_limit>,
+// p:<profile> (RenjuAIProfile built-in name or file, "default" if omitted) and values replacing
+// those of the profile: w:<breadth>/<breadth>/... (search breadth per 2 plies) and
+// e:<score>/<score>/... (evaluation pattern scores), e.g. "d:-1,l:200,p:fast,w:12/6/4/3".
+// Games start from random openings near the center, each opening is played twice with colors
+// swapped. A JSON line is written to stdout as each game finishes, with the running score of A
+// and its 95% error bar. A summary follows the last game: the score, and per configuration its
+// profile, the average depth, nodes/s and histograms of depths and times per move.
+
+#include <ai/ai_controller.h>
+#include <ai/profile.h>
+#include <ai/search_context.h>
+#include <ai/search_session.h>
+#include <utils/json.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Defaults
+#define kSelfPlayGames 20
+#define kSelfPlayBoardSize 15
+#define kSelfPlayOpeningMoves 2
+
+// Opening moves are placed within this distance of the center
+#define kSelfPlayOpeningRadius 2
+
+// Transposition table size (log2 of entries) of each engine in a game
+#define kSelfPlayTTSizeLog2 18
+
+// Upper bounds (ms) of the time per move histogram, the last bucket has no bound
+static const double kTimeBuckets[] = {1, 3, 10, 30, 100, 300, 1000, 3000};
+static const int kTimeBucketCount = sizeof(kTimeBuckets) / sizeof(kTimeBuckets[0]) + 1;
+
+struct SelfPlayConfig {
+    std::string name;
+    std::string spec;
+    int search_depth = 6;
+    int time_limit = 0;
+    RenjuAIProfile profile;
+};
+
+// Moves of one configuration
+struct SelfPlayStats {
+    unsigned int move_count = 0;
+    double depth_sum = 0, time_ms = 0, node_count = 0;
+    std::map<int, unsigned int> depths;
+    std::vector<unsigned int> times = std::vector<unsigned int>(kTimeBucketCount, 0);
+
+    void add(int depth, double move_time_ms, unsigned int nodes) {
+        ++move_count;
+        depth_sum += depth;
+        time_ms += move_time_ms;
+        node_count += nodes;
+        ++depths[depth];
+        int bucket = 0;
+        while (bucket < kTimeBucketCount - 1 && move_time_ms >= kTimeBuckets[bucket]) ++bucket;
+        ++times[bucket];
+    }
+
+    void add(const SelfPlayStats &other) {
+        move_count += other.move_count;
+        depth_sum += other.depth_sum;
+        time_ms += other.time_ms;
+        node_count += other.node_count;
+        for (const auto &d : other.depths) depths[d.first] += d.second;
+        for (int i = 0; i < kTimeBucketCount; ++i) times[i] += other.times[i];
+    }
+
+    nlohmann::json toJson() const {
+        // Buckets in ascending order, times are below "max_ms" (null: No bound)
+        nlohmann::json depth_histogram = nlohmann::json::array(), time_histogram = nlohmann::json::array();
+        for (const auto &d : depths) depth_histogram.push_back({{"depth", d.first}, {"moves", d.second}});
+        for (int i = 0; i < kTimeBucketCount; ++i) {
+            nlohmann::json max_ms;
+            if (i < kTimeBucketCount - 1) max_ms = kTimeBuckets[i];
+            time_histogram.push_back({{"max_ms", max_ms}, {"moves", times[i]}});
+        }
+        return {{"moves", move_count},
+                {"average_depth", move_count > 0 ? depth_sum / move_count : 0},
+                {"nodes_per_sec", time_ms > 0 ? node_count * 1000.0 / time_ms : 0},
+                {"average_time_ms", move_count > 0 ? time_ms / move_count : 0},
+                {"depth_histogram", depth_histogram},
+                {"time_histogram_ms", time_histogram}};
+    }
+};
+
+struct SelfPlayGame {
+    int index;
+    int black;          // Configuration playing black (0: A, 1: B)
+    int winner;         // Winning configuration (-1: Draw)
+    int move_count;
+    std::string opening;
+    SelfPlayStats stats[2];
+};
+
+// Parses values separated by "/"
+static std::vector<int> parseValues(const std::string &text) {
+    std::vector<int> values;
+    std::istringstream items(text);
+    std::string item;
+    while (std::getline(items, item, '/')) values.push_back(atoi(item.c_str()));
+    return values;
+}
+
+// Parses a configuration, returns false if invalid (with error set if its profile is)
+static bool parseConfig(const std::string &spec, SelfPlayConfig *config, std::string *error) {
+    config->spec = spec;
+    std::istringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        if (item.size() < 3 || item[1] != ':') return false;
+        std::string value = item.substr(2);
+        if (item[0] == 'd') {
+            config->search_depth = atoi(value.c_str());
+        } else if (item[0] == 'l') {
+            config->time_limit = atoi(value.c_str());
+        } else if (item[0] == 'p') {
+            if (!RenjuAIProfile::load(value, &config->profile, error)) return false;
+        } else if (item[0] == 'w') {
+            config->profile.breadth = parseValues(value);
+        } else if (item[0] == 'e') {
+            config->profile.pattern_scores = parseValues(value);
+        } else {
+            return false;
+        }
+    }
+    return config->search_depth != 0 && config->search_depth >= -1 && config->search_depth <= 10 &&
+           config->time_limit >= 0 && config->profile.validate(error);
+}
+
+// Places random opening moves near the center, from black on
+static std::string playOpening(int board_size, int moves, uint64_t seed, std::vector<char> *gs) {
+    std::mt19937_64 gen(seed);
+    std::string opening;
+    int center = board_size / 2;
+    for (int i = 0; i < moves; ++i) {
+        int r, c;
+        do {
+            r = center - kSelfPlayOpeningRadius + static_cast<int>(gen() % (2 * kSelfPlayOpeningRadius + 1));
+            c = center - kSelfPlayOpeningRadius + static_cast<int>(gen() % (2 * kSelfPlayOpeningRadius + 1));
+        } while ((*gs)[board_size * r + c] != 0);
+        (*gs)[board_size * r + c] = static_cast<char>(i % 2 + 1);
+        opening.push_back(static_cast<char>('a' + c));
+        opening.push_back(static_cast<char>('a' + r));
+    }
+    return opening;
+}
+
+// Plays a game, openings repeat for pairs of games with colors swapped
+static SelfPlayGame playGame(const SelfPlayConfig *configs, int board_size, int opening_moves, uint64_t seed,
+                             int index) {
+    SelfPlayGame game;
+    game.index = index;
+    game.black = index % 2;
+    game.winner = -1;
+
+    std::vector<char> gs(static_cast<size_t>(board_size * board_size), 0);
+    game.opening = playOpening(board_size, opening_moves, seed + static_cast<uint64_t>(index / 2), &gs);
+    game.move_count = opening_moves;
+
+    // Each engine keeps its search state for the game
+    RenjuAISearchSession session_a(kSelfPlayTTSizeLog2), session_b(kSelfPlayTTSizeLog2);
+    RenjuAISearchSession *sessions[2] = {&session_a, &session_b};
+    int player = opening_moves % 2 + 1;
+    while (game.move_count < board_size * board_size) {
+        int engine = player == 1 ? game.black : 1 - game.black;
+        const SelfPlayConfig &config = configs[engine];
+
+        RenjuAISearchContext ctx(board_size);
+        ctx.session = sessions[engine];
+        config.profile.apply(&ctx);
+
+        int actual_depth = 0, move_r = -1, move_c = -1, winning_player = 0;
+        unsigned int node_count = 0;
+        auto t_start = std::chrono::steady_clock::now();
+        RenjuAIController::generateMove(&ctx, gs.data(), player, config.search_depth, config.time_limit, 1,
+                                        &actual_depth, &move_r, &move_c, &winning_player,
+                                        &node_count, nullptr, nullptr);
+        double time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                   t_start).count();
+        if (move_r < 0 || move_c < 0) break;
+
+        game.stats[engine].add(actual_depth, time_ms, node_count);
+        gs[board_size * move_r + move_c] = static_cast<char>(player);
+        ++game.move_count;
+        if (winning_player != 0) {
+            game.winner = winning_player == 1 ? game.black : 1 - game.black;
+            break;
+        }
+        player = player == 1 ? 2 : 1;
+    }
+    return game;
+}
+
+// Score of A (wins + draws / 2 per game) and its 95% error bar
+static void score(int wins, int draws, int losses, double *result, double *error) {
+    int games = wins + draws + losses;
+    *result = *error = 0;
+    if (games == 0) return;
+
+    double s = (wins + 0.5 * draws) / games;
+    double variance = (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games;
+    *result = s;
+    *error = 1.96 * std::sqrt(variance / games);
+}
+
+int main(int argc, char const *argv[]) {
+    SelfPlayConfig configs[2];
+    configs[0].name = "A";
+    configs[1].name = "B";
+    std::string specs[2] = {"d:6", "d:6"}, output_path;
+    int games = kSelfPlayGames;
+    int parallel_games = std::max(1u, std::thread::hardware_concurrency());
+    int board_size = kSelfPlayBoardSize;
+    int opening_moves = kSelfPlayOpeningMoves;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc - 1; i += 2) {
+        if (strcmp(argv[i], "-A") == 0) specs[0] = argv[i + 1];
+        else if (strcmp(argv[i], "-B") == 0) specs[1] = argv[i + 1];
+        else if (strcmp(argv[i], "-n") == 0) games = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-j") == 0) parallel_games = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-b") == 0) board_size = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-m") == 0) opening_moves = std::max(0, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-s") == 0) seed = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "-o") == 0) output_path = argv[i + 1];
+    }
+    for (int i = 0; i < 2; ++i) {
+        std::string error;
+        if (!parseConfig(specs[i], &configs[i], &error)) {
+            std::cerr << "Invalid config " << configs[i].name << ": " << specs[i]
+                      << (error.empty() ? "" : " (" + error + ")") << std::endl;
+            return 2;
+        }
+    }
+    if (board_size < 15 || board_size > 20 ||
+        opening_moves > (2 * kSelfPlayOpeningRadius + 1) * (2 * kSelfPlayOpeningRadius + 1)) {
+        std::cerr << "Invalid board size or number of opening moves." << std::endl;
+        return 2;
+    }
+
+    // Results are streamed in the order games finish
+    std::mutex mutex;
+    std::atomic<int> next_game(0);
+    int finished = 0, wins = 0, draws = 0, losses = 0;
+    SelfPlayStats totals[2];
+
+    auto work = [&]() {
+        for (int index = next_game++; index < games; index = next_game++) {
+            SelfPlayGame game = playGame(configs, board_size, opening_moves, seed, index);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ++finished;
+            if (game.winner == 0) ++wins;
+            else if (game.winner == 1) ++losses;
+            else ++draws;
+            totals[0].add(game.stats[0]);
+            totals[1].add(game.stats[1]);
+
+            double s, error;
+            score(wins, draws, losses, &s, &error);
+            nlohmann::json line = {{"game", game.index},
+                                   {"opening", game.opening},
+                                   {"black", configs[game.black].name},
+                                   {"winner", game.winner < 0 ? "draw" : configs[game.winner].name},
+                                   {"moves", game.move_count},
+                                   {"finished", finished},
+                                   {"score_a", s},
+                                   {"error_95", error},
+                                   {"A", game.stats[0].toJson()},
+                                   {"B", game.stats[1].toJson()}};
+            std::cout << line.dump() << std::endl;
+            std::cerr << "Game " << finished << "/" << games << ": winner " << line["winner"].get<std::string>()
+                      << ", A scores " << s << " +- " << error << std::endl;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < std::min(parallel_games, games) - 1; ++i) workers.emplace_back(work);
+    work();
+    for (auto &worker : workers) worker.join();
+
+    double s, error;
+    score(wins, draws, losses, &s, &error);
+    nlohmann::json summary;
+    summary["build"] = std::string(__DATE__) + " " + __TIME__;
+    summary["board_size"] = board_size;
+    summary["games"] = finished;
+    summary["seed"] = seed;
+    summary["wins_a"] = wins;
+    summary["draws"] = draws;
+    summary["wins_b"] = losses;
+    summary["score_a"] = s;
+    summary["error_95"] = error;
+    for (int i = 0; i < 2; ++i) {
+        summary["configs"][configs[i].name] = totals[i].toJson();
+        summary["configs"][configs[i].name]["config"] = configs[i].spec;
+        summary["configs"][configs[i].name]["profile"] = {{"name", configs[i].profile.name},
+                                                          {"breadth", configs[i].profile.breadth},
+                                                          {"pattern_scores", configs[i].profile.pattern_scores}};
+    }
+
+    if (output_path.empty()) {
+        std::cout << summary.dump() << std::endl;
+    } else {
+        std::ofstream file(output_path);
+        file << summary.dump(2) << std::endl;
+    }
+    return 0;
+}
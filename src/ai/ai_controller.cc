@@ -19,23 +19,22 @@
 #include <ai/ai_controller.h>
 #include <ai/eval.h>
 #include <ai/negamax.h>
+#include <ai/phase_profiler.h>
 #include <ai/utils.h>
-#include <utils/globals.h>
-#include <cstring>
 
-void RenjuAIController::generateMove(const char *gs, int player, int search_depth, int time_limit,
-                           int *actual_depth, int *move_r, int *move_c, int *winning_player,
-                           unsigned int *node_count, unsigned int *eval_count, unsigned int *pm_count) {
+void RenjuAIController::generateMove(RenjuAISearchContext *ctx, const char *gs, int player, int search_depth,
+                                     int time_limit, int num_threads,
+                                     int *actual_depth, int *move_r, int *move_c, int *winning_player,
+                                     unsigned int *node_count, unsigned int *eval_count, unsigned int *pm_count) {
     // Check arguments
-    if (gs == nullptr ||
+    if (ctx == nullptr || gs == nullptr ||
         player  < 1 || player > 2 ||
         search_depth == 0 || search_depth > 10 ||
-        time_limit < 0 ||
+        time_limit < 0 || num_threads < 1 ||
         move_r == nullptr || move_c == nullptr) return;
 
     // Initialize counters
-    g_eval_count = 0;
-    g_pm_count = 0;
+    ctx->resetCounters();
 
     // Initialize data
     *move_r = -1;
@@ -44,31 +43,41 @@ void RenjuAIController::generateMove(const char *gs, int player, int search_dept
     if (actual_depth != nullptr) *actual_depth = 0;
 
     // Check if anyone wins the game
-    _winning_player = RenjuAIEval::winningPlayer(gs);
+    _winning_player = RenjuAIEval::winningPlayer(ctx, gs);
     if (_winning_player != 0) {
         if (winning_player != nullptr) *winning_player = _winning_player;
         return;
     }
 
-    // Copy game state
-    char *_gs = new char[g_gs_size];
-    std::memcpy(_gs, gs, g_gs_size);
-
-    // Run negamax
-    RenjuAINegamax::heuristicNegamax(_gs, player, search_depth, time_limit, true, actual_depth, move_r, move_c);
+    // Run negamax, the search keeps its own copy of the game state.
+    // Kernels are specialised for the Gomocup and CLI board sizes.
+    // Phases timed on this thread are added to those of worker threads, the search is the wall time.
+    RenjuAIPhaseProfiler::Counters phases_begin = RenjuAIPhaseProfiler::threadCounters();
+    {
+        RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseSearch);
+        switch (ctx->board_size) {
+            case 15:
+                RenjuAINegamax::heuristicNegamax<15>(ctx, gs, player, search_depth, time_limit, num_threads, true,
+                                                     actual_depth, move_r, move_c);
+                break;
+            case 19:
+                RenjuAINegamax::heuristicNegamax<19>(ctx, gs, player, search_depth, time_limit, num_threads, true,
+                                                     actual_depth, move_r, move_c);
+                break;
+            default:
+                RenjuAINegamax::heuristicNegamax(ctx, gs, player, search_depth, time_limit, num_threads, true,
+                                                 actual_depth, move_r, move_c);
+                break;
+        }
+    }
+    ctx->phases.add(RenjuAIPhaseProfiler::threadCounters().since(phases_begin));
 
-    // Execute the move
-    std::memcpy(_gs, gs, g_gs_size);
-    RenjuAIUtils::setCell(_gs, *move_r, *move_c, static_cast<char>(player));
-
-    // Check if anyone wins the game
-    _winning_player = RenjuAIEval::winningPlayer(_gs);
+    // Nobody had won before the move, so only a line through the played cell can win
+    if (RenjuAIUtils::completesFive(gs, ctx->board_size, *move_r, *move_c, player)) _winning_player = player;
 
     // Write output
     if (winning_player != nullptr) *winning_player = _winning_player;
-    if (node_count != nullptr) *node_count = g_node_count;
-    if (eval_count != nullptr) *eval_count = g_eval_count;
-    if (pm_count != nullptr) *pm_count = g_pm_count;
-
-    delete[] _gs;
+    if (node_count != nullptr) *node_count = ctx->node_count;
+    if (eval_count != nullptr) *eval_count = ctx->eval_count;
+    if (pm_count != nullptr) *pm_count = ctx->pm_count;
 }
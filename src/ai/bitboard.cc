@@ -0,0 +1,106 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/bitboard.h>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+RenjuAIBitboard::RenjuAIBitboard(int board_size) {
+    this->board_size = board_size;
+    memset(lines, 0, sizeof(lines));
+    memset(valid, 0, sizeof(valid));
+
+    for (int r = 0; r < board_size; ++r) {
+        for (int c = 0; c < board_size; ++c) {
+            for (int o = 0; o < 4; ++o) {
+                int index, pos;
+                locate(o, r, c, &index, &pos);
+                valid[0][o][index] |= 1u << pos;
+                valid[1][o][index] |= 1u << (kRenjuAiBitboardMaxSize - 1 - pos);
+            }
+        }
+    }
+}
+
+RenjuAIBitboard::RenjuAIBitboard(int board_size, const char *gs) : RenjuAIBitboard(board_size) {
+    for (int r = 0; r < board_size; ++r)
+        for (int c = 0; c < board_size; ++c)
+            if (gs[board_size * r + c] != 0) setCell(r, c, gs[board_size * r + c]);
+}
+
+RenjuAIBitboard::~RenjuAIBitboard() {}
+
+void RenjuAIBitboard::setCell(int r, int c, int value) {
+    for (int o = 0; o < 4; ++o) {
+        int index, pos;
+        locate(o, r, c, &index, &pos);
+        uint32_t bit = 1u << pos, reversed_bit = 1u << (kRenjuAiBitboardMaxSize - 1 - pos);
+        for (int p = 0; p < 2; ++p) {
+            lines[0][p][o][index] &= ~bit;
+            lines[1][p][o][index] &= ~reversed_bit;
+        }
+        if (value == 0) continue;
+        lines[0][value - 1][o][index] |= bit;
+        lines[1][value - 1][o][index] |= reversed_bit;
+    }
+}
+
+int RenjuAIBitboard::winningPlayer() const {
+    // Lines of a player are contiguous and lines outside of the board are empty,
+    // so all lines of all orientations are scanned at once
+    for (int p = 0; p < 2; ++p)
+        if (hasFive(&lines[0][p][0][0], 4 * kRenjuAiBitboardMaxLines)) return p + 1;
+    return 0;
+}
+
+bool RenjuAIBitboard::hasFive(const uint32_t *l, int count) {
+    // 5 pieces in a row end at a bit set in l & l >> 1 & l >> 2 & l >> 3 & l >> 4
+    int i = 0;
+#if defined(__AVX2__)
+    __m256i any = _mm256_setzero_si256();
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(l + i));
+        __m256i f = _mm256_and_si256(v, _mm256_srli_epi32(v, 1));
+        f = _mm256_and_si256(f, _mm256_srli_epi32(f, 2));
+        any = _mm256_or_si256(any, _mm256_and_si256(f, _mm256_srli_epi32(v, 4)));
+    }
+    if (!_mm256_testz_si256(any, any)) return true;
+#elif defined(__SSE2__)
+    __m128i any = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(l + i));
+        __m128i f = _mm_and_si128(v, _mm_srli_epi32(v, 1));
+        f = _mm_and_si128(f, _mm_srli_epi32(f, 2));
+        any = _mm_or_si128(any, _mm_and_si128(f, _mm_srli_epi32(v, 4)));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi32(any, _mm_setzero_si128())) != 0xFFFF) return true;
+#endif
+
+    // Remaining lines, or all of them without SIMD
+    for (; i < count; ++i) {
+        uint32_t f = l[i] & (l[i] >> 1);
+        f &= f >> 2;
+        if (f & (l[i] >> 4)) return true;
+    }
+    return false;
+}
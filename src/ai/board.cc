@@ -0,0 +1,156 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/board.h>
+#include <ai/eval.h>
+#include <ai/phase_profiler.h>
+#include <ai/utils.h>
+#include <algorithm>
+#include <cstring>
+
+RenjuAIBoard::RenjuAIBoard(RenjuAISearchContext *ctx, const char *gs) : bits(ctx->board_size, gs) {
+    board_size = ctx->board_size;
+    cells.assign(gs, gs + ctx->gs_size);
+    int stride = board_size + 1;
+    padded.assign(static_cast<size_t>(stride * (board_size + 2) + 1), kRenjuAiBoardSentinel);
+    for (int r = 0; r < board_size; ++r)
+        for (int c = 0; c < board_size; ++c) padded[paddedIndex(stride, r, c)] = cell(r, c);
+
+    // Evaluate all empty cells
+    for (int player = 1; player <= 2; ++player) {
+        scores[player - 1].assign(ctx->gs_size, 0);
+        for (int r = 0; r < board_size; ++r) {
+            for (int c = 0; c < board_size; ++c) {
+                if (cell(r, c) != 0) continue;
+                scores[player - 1][board_size * r + c] = RenjuAIEval::evalMove(ctx, bits, r, c, player);
+            }
+        }
+    }
+
+    // Count neighbours of all pieces
+    neighbours.assign(ctx->gs_size, 0);
+    memset(candidate_rows, 0, sizeof(candidate_rows));
+    for (int r = 0; r < board_size; ++r)
+        for (int c = 0; c < board_size; ++c)
+            if (cell(r, c) != 0) updateNeighbours(r, c, 1);
+
+    // Enough for a full-depth search without reallocation
+    reserve(64);
+}
+
+RenjuAIBoard::~RenjuAIBoard() {}
+
+void RenjuAIBoard::reserve(int max_moves) {
+    // A move saves both values of its cell and up to 2 cells
+    // in each of 8 directions for both players
+    undo_entries.reserve(undo_entries.size() + 34 * max_moves);
+    undo_moves.reserve(undo_moves.size() + max_moves);
+    moves.reserve(moves.size() + max_moves);
+}
+
+template <int kBoardSize>
+void RenjuAIBoard::makeMove(RenjuAISearchContext *ctx, int r, int c, int player) {
+    RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseBoardUpdate);
+    int index = RenjuAIUtils::boardSize<kBoardSize>(board_size) * r + c;
+    undo_moves.push_back(static_cast<int>(undo_entries.size()));
+    moves.push_back(index);
+
+    // Values of the occupied cell are restored on unmake
+    undo_entries.push_back({index, 1, scores[0][index]});
+    undo_entries.push_back({index, 2, scores[1][index]});
+    cells[index] = static_cast<char>(player);
+    padded[paddedIndex(RenjuAIUtils::boardSize<kBoardSize>(board_size) + 1, r, c)] = static_cast<char>(player);
+    bits.setCell(r, c, player);
+    updateNeighbours(r, c, 1);
+
+    // Only cells on the 4 lines through (r, c) can change
+    for (int p = 1; p <= 2; ++p) {
+        updateDirection<kBoardSize>(ctx, r, c,  0,  1, p);
+        updateDirection<kBoardSize>(ctx, r, c,  0, -1, p);
+        updateDirection<kBoardSize>(ctx, r, c,  1,  1, p);
+        updateDirection<kBoardSize>(ctx, r, c, -1, -1, p);
+        updateDirection<kBoardSize>(ctx, r, c,  1,  0, p);
+        updateDirection<kBoardSize>(ctx, r, c, -1,  0, p);
+        updateDirection<kBoardSize>(ctx, r, c,  1, -1, p);
+        updateDirection<kBoardSize>(ctx, r, c, -1,  1, p);
+    }
+}
+
+void RenjuAIBoard::unmakeMove() {
+    RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseBoardUpdate);
+    int begin = undo_moves.back();
+    for (int i = static_cast<int>(undo_entries.size()) - 1; i >= begin; --i) {
+        const UndoEntry &entry = undo_entries[i];
+        scores[entry.player - 1][entry.index] = entry.score;
+    }
+    undo_entries.resize(begin);
+    undo_moves.pop_back();
+
+    int r = moves.back() / board_size, c = moves.back() % board_size;
+    cells[moves.back()] = 0;
+    padded[paddedIndex(board_size + 1, r, c)] = 0;
+    bits.setCell(r, c, 0);
+    updateNeighbours(r, c, -1);
+    moves.pop_back();
+}
+
+void RenjuAIBoard::updateNeighbours(int r, int c, int delta) {
+    int r_begin = std::max(r - 2, 0), r_end = std::min(r + 2, board_size - 1);
+    int c_begin = std::max(c - 2, 0), c_end = std::min(c + 2, board_size - 1);
+    for (int i = r_begin; i <= r_end; ++i) {
+        uint32_t row = candidate_rows[i];
+        for (int j = c_begin; j <= c_end; ++j) {
+            int index = board_size * i + j;
+            neighbours[index] = static_cast<unsigned char>(neighbours[index] + delta);
+
+            uint32_t bit = 1u << j;
+            if (neighbours[index] > 0 && cells[index] == 0) row |= bit;
+            else                                            row &= ~bit;
+        }
+        candidate_rows[i] = row;
+    }
+}
+
+template <int kBoardSize>
+void RenjuAIBoard::updateDirection(RenjuAISearchContext *ctx, int r, int c, int dr, int dc, int player) {
+    // A measurement from an empty cell walks over pieces of the player and
+    // at most one space (peeking the cell after it), so it can reach (r, c)
+    // only if no more than one empty cell and no opponent piece is in between.
+    // The walk ends at the sentinel border like at an opponent piece.
+    const int size = RenjuAIUtils::boardSize<kBoardSize>(board_size), stride = size + 1;
+    const int step = stride * dr + dc;
+    int empty_count = 0;
+    int cr = r + dr, cc = c + dc;
+    for (int i = paddedIndex(stride, r, c) + step;; i += step, cr += dr, cc += dc) {
+        char value = padded[i];
+
+        if (value == 0) {
+            int index = size * cr + cc;
+            undo_entries.push_back({index, player, scores[player - 1][index]});
+            scores[player - 1][index] = RenjuAIEval::evalMove<kBoardSize>(ctx, bits, cr, cc, player);
+            if (++empty_count > 1) break;
+        } else if (value != player) {
+            break;
+        }
+    }
+}
+
+// Kernels specialised for the Gomocup and CLI board sizes, 0 reads the board size at runtime
+template void RenjuAIBoard::makeMove<0>(RenjuAISearchContext *, int, int, int);
+template void RenjuAIBoard::makeMove<15>(RenjuAISearchContext *, int, int, int);
+template void RenjuAIBoard::makeMove<19>(RenjuAISearchContext *, int, int, int);
@@ -17,46 +17,40 @@
  */
 
 #include <ai/eval.h>
+#include <ai/phase_profiler.h>
 #include <ai/utils.h>
-#include <utils/globals.h>
 #include <stdlib.h>
 #include <algorithm>
 #include <climits>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
 
-// Initialize global variables
-RenjuAIEval::DirectionPattern *RenjuAIEval::preset_patterns = nullptr;
-int *RenjuAIEval::preset_scores = nullptr;
-int preset_patterns_size = 0;
-int preset_patterns_skip[6] = {0};
-
-int RenjuAIEval::evalState(const char *gs, int player) {
+int RenjuAIEval::evalState(RenjuAISearchContext *ctx, const char *gs, int player) {
     // Check parameters
     if (gs == nullptr ||
         player < 1 || player > 2) return 0;
 
     // Evaluate all possible moves
+    RenjuAIBitboard bb(ctx->board_size, gs);
     int score = 0;
-    for (int r = 0; r < g_board_size; ++r) {
-        for (int c = 0; c < g_board_size; ++c) {
-            score += evalMove(gs, r, c, player);
+    for (int r = 0; r < ctx->board_size; ++r) {
+        for (int c = 0; c < ctx->board_size; ++c) {
+            score += evalMove(ctx, bb, r, c, player);
         }
     }
     return score;
 }
 
-int RenjuAIEval::evalMove(const char *gs, int r, int c, int player) {
+int RenjuAIEval::evalMove(RenjuAISearchContext *ctx, const char *gs, int r, int c, int player) {
     // Check parameters
     if (gs == nullptr ||
         player < 1 || player > 2) return 0;
 
     // Count evaluations
-    ++g_eval_count;
-
-    // Generate preset patterns structure in memory
-    if (preset_patterns == nullptr) {
-        generatePresetPatterns(&preset_patterns, &preset_scores, &preset_patterns_size, preset_patterns_skip);
-    }
+    ++ctx->eval_count;
+    RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseEvalMove);
 
     // Allocate 4 direction measurements
     DirectionMeasurement adm[4];
@@ -65,9 +59,9 @@ int RenjuAIEval::evalMove(const char *gs, int r, int c, int player) {
     int max_score = 0;
     for (bool consecutive = false;; consecutive = true) {
         // Execute measurement
-        measureAllDirections(gs, r, c, player, consecutive, adm);
+        measureAllDirections(ctx, gs, r, c, player, consecutive, adm);
 
-        int score = evalADM(adm);
+        int score = evalADM(ctx, adm);
 
         // Prefer consecutive
         // if (!consecutive) score *= 0.9;
@@ -80,9 +74,35 @@ int RenjuAIEval::evalMove(const char *gs, int r, int c, int player) {
     return max_score;
 }
 
-int RenjuAIEval::evalADM(DirectionMeasurement *all_direction_measurement) {
+template <int kBoardSize>
+int RenjuAIEval::evalMove(RenjuAISearchContext *ctx, const RenjuAIBitboard &bb, int r, int c, int player) {
+    // Check parameters
+    if (player < 1 || player > 2) return 0;
+
+    // Count evaluations
+    ++ctx->eval_count;
+    RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseEvalMove);
+
+    // Measure in consecutive and non-consecutive conditions
+    DirectionMeasurement adm[4];
+    measureAllDirections<kBoardSize>(bb, r, c, player, false, adm);
+    int max_score = evalADM(ctx, adm);
+    measureAllDirections<kBoardSize>(bb, r, c, player, true, adm);
+    return std::max(max_score, evalADM(ctx, adm));
+}
+
+int RenjuAIEval::evalADM(RenjuAISearchContext *ctx, DirectionMeasurement *all_direction_measurement) {
+    // Count lookups as pattern matches
+    ctx->pm_count++;
+    RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhasePatternMatch);
+    const int *adm_scores = ctx->adm_scores != nullptr ? ctx->adm_scores : presetPatterns().adm_scores;
+    return adm_scores[admIndex(all_direction_measurement)];
+}
+
+int RenjuAIEval::matchPresetPatterns(RenjuAISearchContext *ctx, const PresetPatterns &preset,
+                                     DirectionMeasurement *all_direction_measurement) {
     int score = 0;
-    int size = preset_patterns_size;
+    int size = preset.size;
 
     // Add to score by length on each direction
     // Find the maximum length in ADM and skip some patterns
@@ -92,11 +112,11 @@ int RenjuAIEval::evalADM(DirectionMeasurement *all_direction_measurement) {
         max_measured_len = len > max_measured_len ? len : max_measured_len;
         score += len - 1;
     }
-    int start_pattern = preset_patterns_skip[max_measured_len];
+    int start_pattern = preset.skip[max_measured_len];
 
     // Loop through and try to match all preset patterns
     for (int i = start_pattern; i < size; ++i) {
-        score += matchPattern(all_direction_measurement, &preset_patterns[2 * i]) * preset_scores[i];
+        score += matchPattern(ctx, all_direction_measurement, &preset.patterns[2 * i]) * preset.scores[i];
 
         // Only match one threatening pattern
         if (score >= kRenjuAiEvalThreateningScore) break;
@@ -105,14 +125,51 @@ int RenjuAIEval::evalADM(DirectionMeasurement *all_direction_measurement) {
     return score;
 }
 
-int RenjuAIEval::matchPattern(DirectionMeasurement *all_direction_measurement,
+// Offsets of the combinatorial number system for multisets of 4 codes:
+// sorted codes a <= b <= c <= d map to C(a, 1) + C(b + 1, 2) + C(c + 2, 3) + C(d + 3, 4)
+static int binomial(int n, int k) {
+    if (k < 0 || n < k) return 0;
+    int result = 1;
+    for (int i = 1; i <= k; ++i) result = result * (n - k + i) / i;
+    return result;
+}
+
+static const struct ADMIndexOffsets {
+    int offsets[4][kRenjuAiEvalDMCodes];
+    ADMIndexOffsets() {
+        for (int i = 0; i < 4; ++i)
+            for (int code = 0; code < kRenjuAiEvalDMCodes; ++code)
+                offsets[i][code] = binomial(code + i, i + 1);
+    }
+} adm_index_offsets;
+
+int RenjuAIEval::admIndex(const DirectionMeasurement *all_direction_measurement) {
+    int a = dmCode(all_direction_measurement[0]);
+    int b = dmCode(all_direction_measurement[1]);
+    int c = dmCode(all_direction_measurement[2]);
+    int d = dmCode(all_direction_measurement[3]);
+
+    // Sorting network
+    if (a > b) std::swap(a, b);
+    if (c > d) std::swap(c, d);
+    if (a > c) std::swap(a, c);
+    if (b > d) std::swap(b, d);
+    if (b > c) std::swap(b, c);
+
+    const int (*o)[kRenjuAiEvalDMCodes] = adm_index_offsets.offsets;
+    return o[0][a] + o[1][b] + o[2][c] + o[3][d];
+}
+
+int RenjuAIEval::matchPattern(RenjuAISearchContext *ctx,
+                              DirectionMeasurement *all_direction_measurement,
                               DirectionPattern *patterns) {
     // Check arguments
     if (all_direction_measurement == nullptr) return -1;
     if (patterns == nullptr) return -1;
 
     // Increment PM count
-    g_pm_count++;
+    if (ctx != nullptr) ctx->pm_count++;
+    RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhasePatternMatch);
 
     // Initialize match_count to INT_MAX since minimum value will be output
     int match_count = INT_MAX, single_pattern_match = 0;
@@ -146,7 +203,8 @@ int RenjuAIEval::matchPattern(DirectionMeasurement *all_direction_measurement,
     return match_count;
 }
 
-void RenjuAIEval::measureAllDirections(const char *gs,
+void RenjuAIEval::measureAllDirections(const RenjuAISearchContext *ctx,
+                                       const char *gs,
                                        int r,
                                        int c,
                                        int player,
@@ -154,16 +212,17 @@ void RenjuAIEval::measureAllDirections(const char *gs,
                                        RenjuAIEval::DirectionMeasurement *adm) {
     // Check arguments
     if (gs == nullptr) return;
-    if (r < 0 || r >= g_board_size || c < 0 || c >= g_board_size) return;
+    if (r < 0 || r >= ctx->board_size || c < 0 || c >= ctx->board_size) return;
 
     // Measure 4 directions
-    measureDirection(gs, r, c, 0,  1, player, consecutive, &adm[0]);
-    measureDirection(gs, r, c, 1,  1, player, consecutive, &adm[1]);
-    measureDirection(gs, r, c, 1,  0, player, consecutive, &adm[2]);
-    measureDirection(gs, r, c, 1, -1, player, consecutive, &adm[3]);
+    measureDirection(ctx, gs, r, c, 0,  1, player, consecutive, &adm[0]);
+    measureDirection(ctx, gs, r, c, 1,  1, player, consecutive, &adm[1]);
+    measureDirection(ctx, gs, r, c, 1,  0, player, consecutive, &adm[2]);
+    measureDirection(ctx, gs, r, c, 1, -1, player, consecutive, &adm[3]);
 }
 
-void RenjuAIEval::measureDirection(const char *gs,
+void RenjuAIEval::measureDirection(const RenjuAISearchContext *ctx,
+                                   const char *gs,
                                    int r, int c,
                                    int dr, int dc,
                                    int player,
@@ -171,7 +230,8 @@ void RenjuAIEval::measureDirection(const char *gs,
                                    RenjuAIEval::DirectionMeasurement *result) {
     // Check arguments
     if (gs == nullptr) return;
-    if (r < 0 || r >= g_board_size || c < 0 || c >= g_board_size) return;
+    int board_size = ctx->board_size;
+    if (r < 0 || r >= board_size || c < 0 || c >= board_size) return;
     if (dr == 0 && dc == 0) return;
 
     // Initialization
@@ -187,14 +247,14 @@ void RenjuAIEval::measureDirection(const char *gs,
             cr += dr; cc += dc;
 
             // Validate position
-            if (cr < 0 || cr >= g_board_size || cc < 0 || cc >= g_board_size) break;
+            if (cr < 0 || cr >= board_size || cc < 0 || cc >= board_size) break;
 
             // Get cell value
-            int cell = gs[g_board_size * cr + cc];
+            int cell = gs[board_size * cr + cc];
 
             // Empty cells
             if (cell == 0) {
-                if (space_allowance > 0 && RenjuAIUtils::getCell(gs, cr + dr, cc + dc) == player) {
+                if (space_allowance > 0 && RenjuAIUtils::getCell(gs, board_size, cr + dr, cc + dc) == player) {
                     space_allowance--; result->space_count++;
                     continue;
                 } else {
@@ -228,11 +288,111 @@ void RenjuAIEval::measureDirection(const char *gs,
     }
 }
 
+template <int kBoardSize>
+void RenjuAIEval::measureAllDirections(const RenjuAIBitboard &bb,
+                                       int r,
+                                       int c,
+                                       int player,
+                                       bool consecutive,
+                                       RenjuAIEval::DirectionMeasurement *adm) {
+    for (int o = 0; o < 4; ++o) measureDirection<kBoardSize>(bb, r, c, o, player, consecutive, &adm[o]);
+}
+
+template <int kBoardSize>
+void RenjuAIEval::measureDirection(const RenjuAIBitboard &bb,
+                                   int r, int c,
+                                   int orientation,
+                                   int player,
+                                   bool consecutive,
+                                   RenjuAIEval::DirectionMeasurement *result) {
+    result->length = 1, result->block_count = 2, result->space_count = 0;
+
+    // The space allowance is shared by both sides, forward side first
+    int space_allowance = consecutive ? 0 : 1;
+    measureSide(bb.forward<kBoardSize>(player, orientation, r, c), bb.forwardEmpty<kBoardSize>(orientation, r, c),
+                &space_allowance, result);
+    measureSide(bb.backward<kBoardSize>(player, orientation, r, c), bb.backwardEmpty<kBoardSize>(orientation, r, c),
+                &space_allowance, result);
+
+    // More than 5 pieces in a row is equivalent to 5 pieces
+    if (result->length >= 5) {
+        if (result->space_count == 0) {
+            result->length = 5;
+            result->block_count = 0;
+        } else {
+            result->length = 4;
+            result->block_count = 1;
+        }
+    }
+}
+
+const RenjuAIEval::PresetPatterns &RenjuAIEval::presetPatterns() {
+    static const PresetPatterns preset = []() {
+        PresetPatterns p;
+        generatePresetPatterns(&p.patterns, &p.scores, &p.size, p.skip);
+        p.adm_scores = generateADMScores(p);
+        return p;
+    }();
+    return preset;
+}
+
+const int *RenjuAIEval::scoreTable(const std::vector<int> &pattern_scores) {
+    const PresetPatterns &preset = presetPatterns();
+    if (pattern_scores.size() != static_cast<size_t>(preset.size)) return nullptr;
+    if (std::equal(pattern_scores.begin(), pattern_scores.end(), preset.scores)) return preset.adm_scores;
+
+    static std::mutex mutex;
+    static std::map<std::vector<int>, std::unique_ptr<int[]>> tables;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<int[]> &table = tables[pattern_scores];
+    if (table == nullptr) {
+        PresetPatterns p = preset;
+        p.scores = const_cast<int *>(pattern_scores.data());
+        table.reset(generateADMScores(p));
+    }
+    return table.get();
+}
+
+int *RenjuAIEval::generateADMScores(const PresetPatterns &preset) {
+    // Evaluate every unordered combination of 4 direction measurements
+    int *adm_scores = new int[kRenjuAiEvalADMCodes];
+    DirectionMeasurement adm[4];
+    int codes[4];
+    for (codes[3] = 0; codes[3] < kRenjuAiEvalDMCodes; ++codes[3])
+    for (codes[2] = 0; codes[2] <= codes[3]; ++codes[2])
+    for (codes[1] = 0; codes[1] <= codes[2]; ++codes[1])
+    for (codes[0] = 0; codes[0] <= codes[1]; ++codes[0]) {
+        for (int i = 0; i < 4; ++i) {
+            adm[i].length = static_cast<char>(codes[i] / 6 + 1);
+            adm[i].block_count = static_cast<char>(codes[i] % 6 / 2);
+            adm[i].space_count = static_cast<char>(codes[i] % 2);
+        }
+        adm_scores[admIndex(adm)] = matchPresetPatterns(nullptr, preset, adm);
+    }
+    return adm_scores;
+}
+
+const int RenjuAIEval::presetScores[kRenjuAiEvalPatterns] = {
+    10000,
+    700,
+    700,
+    700,
+    700,
+    500,
+    500,
+    300,
+    // 1,
+    // 1,
+    50,
+    20,
+    9
+};
+
 void RenjuAIEval::generatePresetPatterns(DirectionPattern **preset_patterns,
                                          int **preset_scores,
                                          int *preset_patterns_size,
                                          int *preset_patterns_skip) {
-    const int _size = 11;
+    const int _size = kRenjuAiEvalPatterns;
     preset_patterns_skip[5] = 0;
     preset_patterns_skip[4] = 1;
     preset_patterns_skip[3] = 7;
@@ -257,46 +417,27 @@ void RenjuAIEval::generatePresetPatterns(DirectionPattern **preset_patterns,
         {1, 2,  0, -1}, {0, 0,  0,  0}   // 9
     };
 
-    int scores[_size] = {
-        10000,
-        700,
-        700,
-        700,
-        700,
-        500,
-        500,
-        300,
-        // 1,
-        // 1,
-        50,
-        20,
-        9
-    };
-
     *preset_patterns = new DirectionPattern[_size * 2];
     *preset_scores   = new int[_size];
 
     memcpy(*preset_patterns, patterns, sizeof(DirectionPattern) * _size * 2);
-    memcpy(*preset_scores, scores, sizeof(int) * _size);
+    memcpy(*preset_scores, presetScores, sizeof(int) * _size);
 
     *preset_patterns_size = _size;
 }
 
-int RenjuAIEval::winningPlayer(const char *gs) {
+int RenjuAIEval::winningPlayer(const RenjuAISearchContext *ctx, const char *gs) {
     if (gs == nullptr) return 0;
-    for (int r = 0; r < g_board_size; ++r) {
-        for (int c = 0; c < g_board_size; ++c) {
-            int cell = gs[g_board_size * r + c];
-            if (cell == 0) continue;
-            for (int dr = -1; dr <= 1; ++dr) {
-                for (int dc = -1; dc <= 1; ++dc) {
-                    if (dr == 0 && dc <= 0) continue;
-                    DirectionMeasurement dm;
-                    measureDirection(gs, r, c, dr, dc, cell, 1, &dm);
-                    if (dm.length >= 5) return cell;
-                }
-            }
-        }
-    }
-    return 0;
+    return winningPlayer(RenjuAIBitboard(ctx->board_size, gs));
+}
+
+int RenjuAIEval::winningPlayer(const RenjuAIBitboard &bb) {
+    return bb.winningPlayer();
 }
+
+// Kernels specialised for the Gomocup and CLI board sizes, 0 reads the board size at runtime
+template int RenjuAIEval::evalMove<0>(RenjuAISearchContext *, const RenjuAIBitboard &, int, int, int);
+template int RenjuAIEval::evalMove<15>(RenjuAISearchContext *, const RenjuAIBitboard &, int, int, int);
+template int RenjuAIEval::evalMove<19>(RenjuAISearchContext *, const RenjuAIBitboard &, int, int, int);
+template void RenjuAIEval::measureDirection<0>(const RenjuAIBitboard &, int, int, int, int, bool,
+                                               RenjuAIEval::DirectionMeasurement *);
@@ -17,24 +17,38 @@
  */
 
 #include <ai/negamax.h>
+#include <ai/board.h>
 #include <ai/eval.h>
+#include <ai/phase_profiler.h>
+#include <ai/search_session.h>
+#include <ai/threat_solver.h>
+#include <ai/time_manager.h>
+#include <ai/transposition_table.h>
 #include <ai/utils.h>
-#include <utils/globals.h>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <climits>
+#include <cmath>
 #include <cstring>
 #include <cstdlib>
-#include <ctime>
 #include <iostream>
+#include <thread>
 
 // kSearchBreadth is used to control branching factor
 // Different breadth configurations are possible:
 // A lower breadth for a higher depth
 // Or vice versa
-int RenjuAINegamax::presetSearchBreadth[5] = {17, 7, 5, 3, 3};
+const int RenjuAINegamax::presetSearchBreadth[kRenjuAiSearchBreadthLevels] = {17, 7, 5, 3, 3};
 
-// Estimated average branching factor for iterative deepening
-#define kAvgBranchingFactor 3
+// Move ordering: history counts per point of heuristic value, the largest history bonus
+// and the bonus of the first killer move (halved for each later slot)
+#define kHistoryScale 40
+#define kHistoryMaxBonus 300
+#define kKillerBonus 100
+
+// First depth of iterative deepening
+#define kMinimumDepth 6
 
 // Maximum depth for iterative deepening
 #define kMaximumDepth 16
@@ -43,76 +57,359 @@ int RenjuAINegamax::presetSearchBreadth[5] = {17, 7, 5, 3, 3};
 // prefers closer advantages
 #define kScoreDecayFactor 0.95f
 
-void RenjuAINegamax::heuristicNegamax(const char *gs, int player, int depth, int time_limit, bool enable_ab_pruning,
+// Half width of the aspiration window around the score of the previous iteration,
+// the root is searched with a full window once scores reach kRenjuAiEvalThreateningScore
+#define kAspirationWindow 50
+
+RenjuAINegamax::MoveArena::MoveArena(const RenjuAISearchContext *ctx, int max_depth) {
+    gs_size = static_cast<int>(ctx->gs_size);
+
+    // Candidates are at most 2 blocking moves and the widest breadth
+    int max_breadth = 0;
+    int levels = std::max(kRenjuAiSearchBreadthLevels, static_cast<int>(ctx->breadth.size()));
+    for (int level = 0; level < levels; ++level) max_breadth = std::max(max_breadth, searchBreadth(ctx, level));
+    ply_size = 2 * gs_size + 2 + std::min(max_breadth, gs_size);
+    moves.resize(static_cast<size_t>(ply_size) * max_depth);
+}
+
+void RenjuAINegamax::heuristicNegamax(RenjuAISearchContext *ctx, const char *gs, int player, int depth,
+                                      int time_limit, int num_threads, bool enable_ab_pruning,
+                                      int *actual_depth, int *move_r, int *move_c) {
+    heuristicNegamax<0>(ctx, gs, player, depth, time_limit, num_threads, enable_ab_pruning,
+                        actual_depth, move_r, move_c);
+}
+
+template <int kBoardSize>
+void RenjuAINegamax::heuristicNegamax(RenjuAISearchContext *ctx, const char *gs, int player, int depth,
+                                      int time_limit, int num_threads, bool enable_ab_pruning,
                                       int *actual_depth, int *move_r, int *move_c) {
     // Check arguments
-    if (gs == nullptr ||
+    if (ctx == nullptr || gs == nullptr ||
         player < 1 || player > 2 ||
         depth == 0 || depth < -1 ||
-        time_limit < 0) return;
+        time_limit < 0 || num_threads < 1) return;
 
     // Copy game state
-    char *_gs = new char[g_gs_size];
-    memcpy(_gs, gs, g_gs_size);
+    unsigned int gs_size = ctx->gs_size;
+    RenjuAIBoard board(ctx, gs);
 
     // Speedup first move
     int _cnt = 0;
-    for (int i = 0; i < static_cast<int>(g_gs_size); i++)
-        if (_gs[i] != 0) _cnt++;
+    for (int i = 0; i < static_cast<int>(gs_size); i++)
+        if (gs[i] != 0) _cnt++;
 
     if (_cnt <= 2) depth = 6;
 
-    // Fixed depth or iterative deepening
-    if (depth > 0) {
+    // Transposition table shared by all iterations of this search
+    RenjuAISearchSession *session = ctx->session;
+    RenjuAITranspositionTable *search_tt = nullptr;
+    bool session_tt = ctx->tt == nullptr && session != nullptr;
+    if (session_tt) ctx->tt = &session->tt;
+    if (ctx->tt == nullptr) ctx->tt = search_tt = new RenjuAITranspositionTable(ctx->tt_size_log2);
+    ctx->tt->newSearch();
+    RenjuAIUtils::SymmetricHash hash;
+    RenjuAIUtils::zobristHash(gs, ctx->board_size, ctx->tt->zobrist_1, ctx->tt->zobrist_2, &hash);
+
+    // Continue the principal variation of the previous search if the game followed it
+    ctx->pv_hint.clear();
+    if (session != nullptr) ctx->pv_hint = session->continuation(gs, ctx->board_size, player);
+
+    // Move lists for the deepest iteration
+    int max_plies = std::max(depth, kMaximumDepth);
+    MoveArena arena(ctx, max_plies);
+
+    // Move ordering tables, continued from the previous search of this game
+    ctx->resetKillers(max_plies);
+    std::fill(ctx->history.begin(), ctx->history.end(), 0);
+    if (session != nullptr) session->restoreOrdering(ctx, gs, player);
+
+    // Wall time is used since CPU time adds up across threads.
+    // The threat solver and a running iteration are aborted at the deadline.
+    ctx->aborted = false;
+    ctx->iterations.clear();
+    auto t_start = std::chrono::steady_clock::now();
+    if (depth < 0 && time_limit > 0) ctx->deadline = t_start + std::chrono::milliseconds(time_limit);
+
+    // Forcing wins are proven by the threat solver first
+    int completed_depth = 0;
+    std::vector<std::pair<int, int>> threat_sequence;
+    bool solved = RenjuAIThreatSolver::solve(ctx, board, player, &threat_sequence);
+
+    // Fixed depth or iterative deepening otherwise, the root of the first iteration
+    // still produces a move if the solver ran out of time
+    ctx->aborted = false;
+    if (solved) {
+        // A forcing win proven by the threat solver, recorded as a single iteration
+        RenjuAISearchIteration it = {};
+        it.depth = completed_depth = static_cast<int>(threat_sequence.size());
+        it.completed = true;
+        it.score = kRenjuAiEvalWinningScore;
+        it.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                               t_start).count();
+        it.pv = threat_sequence;
+        ctx->iterations.push_back(it);
+        if (ctx->on_iteration) ctx->on_iteration(it);
+
+        if (actual_depth != nullptr) *actual_depth = completed_depth;
+        if (move_r != nullptr) *move_r = threat_sequence[0].first;
+        if (move_c != nullptr) *move_c = threat_sequence[0].second;
+    } else if (depth > 0) {
         if (actual_depth != nullptr) *actual_depth = depth;
-        heuristicNegamax(_gs, player, depth, depth, enable_ab_pruning,
-                         INT_MIN / 2, INT_MAX / 2, move_r, move_c);
+        searchIteration<kBoardSize>(ctx, &board, &arena, hash, player, depth, num_threads, enable_ab_pruning,
+                                    move_r, move_c);
+        if (!ctx->aborted) completed_depth = depth;
     } else {
         // Iterative deepening
-        std::clock_t c_start = std::clock();
-        for (int d = 6;; d += 2) {
-            std::clock_t c_iteration_start = std::clock();
 
-            // Reset game state
-            memcpy(_gs, gs, g_gs_size);
+        // Shallow iterations were searched on the previous turn, their results are in the table.
+        // They are skipped only if the deeper start is expected to complete, an aborted start
+        // would replace a completed shallow result with an unverified move.
+        int start_depth = kMinimumDepth;
+        double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                      t_start).count();
+        if (!ctx->pv_hint.empty() && RenjuAITimeManager::continueDeep(session->time_ms, elapsed_ms, time_limit)) {
+            start_depth = std::min(std::max(kMinimumDepth, (session->depth - 2) & ~1), kMaximumDepth);
+        }
 
+        int best_r = -1, best_c = -1;
+        for (int d = start_depth;; d += 2) {
             // Execute negamax
-            heuristicNegamax(_gs, player, d, d, enable_ab_pruning,
-                             INT_MIN / 2, INT_MAX / 2, move_r, move_c);
+            // All moves are unmade afterwards so the game state is reused
+            int iteration_r = -1, iteration_c = -1;
+            searchIteration<kBoardSize>(ctx, &board, &arena, hash, player, d, num_threads, enable_ab_pruning,
+                                        &iteration_r, &iteration_c);
+
+            // Keep the last completed iteration, the best move found so far
+            // is only used if no iteration has completed
+            if (ctx->aborted) {
+                if (best_r < 0) { best_r = iteration_r; best_c = iteration_c; }
+                break;
+            }
+            best_r = iteration_r; best_c = iteration_c;
+            completed_depth = d;
+
+            // The next iteration searches this principal variation first
+            ctx->pv_hint = ctx->iterations.back().pv;
+
+            // Stop if the next iteration is not expected to end in time
+            elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                                   t_start).count();
+            if (d >= kMaximumDepth || !RenjuAITimeManager::nextIteration(ctx->iterations, elapsed_ms, time_limit))
+                break;
+        }
+
+        if (actual_depth != nullptr) *actual_depth = completed_depth;
+        if (move_r != nullptr) *move_r = best_r;
+        if (move_c != nullptr) *move_c = best_c;
+    }
+    ctx->deadline = std::chrono::steady_clock::time_point::max();
+
+    // Keep the deepest completed result for the next search of this game
+    if (session != nullptr) session->saveOrdering(*ctx);
+    if (session != nullptr && completed_depth > 0) {
+        for (auto it = ctx->iterations.rbegin(); it != ctx->iterations.rend(); ++it) {
+            if (it->completed) {
+                session->update(gs, ctx->board_size, player, completed_depth, it->time_ms, it->pv);
+                break;
+            }
+        }
+    }
+
+    // Release table allocated for this search
+    if (session_tt) ctx->tt = nullptr;
+    if (search_tt != nullptr) {
+        ctx->tt = nullptr;
+        delete search_tt;
+    }
+}
+
+template <int kBoardSize>
+void RenjuAINegamax::searchIteration(RenjuAISearchContext *ctx, RenjuAIBoard *board, MoveArena *arena,
+                                     const RenjuAIUtils::SymmetricHash &hash, int player, int depth, int num_threads,
+                                     bool enable_ab_pruning, int *move_r, int *move_c) {
+    RenjuAISearchIteration it;
+    it.depth = depth;
+
+    // Counters are cumulative over the search, iterations report differences
+    const struct {
+        unsigned int node_count, eval_count, beta_cutoffs, first_move_cutoffs, re_searches, tt_probes, tt_hits;
+    } before = {ctx->node_count, ctx->eval_count, ctx->beta_cutoffs, ctx->first_move_cutoffs, ctx->re_searches,
+                ctx->tt_probes, ctx->tt_hits};
+    auto t_start = std::chrono::steady_clock::now();
+
+    // Search within a window around the score of the previous iteration, the side the score
+    // falls outside of is widened to the full window and the root is searched again
+    int alpha = INT_MIN / 2, beta = INT_MAX / 2;
+    it.aspiration_fails = 0;
+    if (enable_ab_pruning && !ctx->iterations.empty() && ctx->iterations.back().completed &&
+        std::abs(ctx->iterations.back().score) < kRenjuAiEvalThreateningScore) {
+        alpha = ctx->iterations.back().score - kAspirationWindow;
+        beta = ctx->iterations.back().score + kAspirationWindow;
+    }
+
+    int r = -1, c = -1;
+    for (;;) {
+        it.score = heuristicNegamax<kBoardSize>(ctx, board, arena, hash, player, depth, depth, num_threads,
+                                                enable_ab_pruning, alpha, beta, &r, &c);
+        if (ctx->aborted) break;
+        if (it.score <= alpha && alpha > INT_MIN / 2) alpha = INT_MIN / 2;
+        else if (decayScore(it.score) >= beta && beta < INT_MAX / 2) beta = INT_MAX / 2;
+        else break;
+        ++it.aspiration_fails;
+    }
+    if (move_r != nullptr) *move_r = r;
+    if (move_c != nullptr) *move_c = c;
+
+    it.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+    it.completed = !ctx->aborted;
+    it.node_count = ctx->node_count - before.node_count;
+    it.eval_count = ctx->eval_count - before.eval_count;
+    it.beta_cutoffs = ctx->beta_cutoffs - before.beta_cutoffs;
+    it.first_move_cutoffs = ctx->first_move_cutoffs - before.first_move_cutoffs;
+    it.re_searches = ctx->re_searches - before.re_searches;
+    it.tt_probes = ctx->tt_probes - before.tt_probes;
+    it.tt_hits = ctx->tt_hits - before.tt_hits;
+    it.tt_usage = ctx->tt->usage();
+
+    // Nodes grow by this factor per ply, compared to the previous iteration if any
+    int base_depth = 0;
+    double base_nodes = 1;
+    if (!ctx->iterations.empty() && ctx->iterations.back().node_count > 0) {
+        base_depth = ctx->iterations.back().depth;
+        base_nodes = ctx->iterations.back().node_count;
+    }
+    it.branching_factor = depth > base_depth && it.node_count > 0 ?
+                          std::pow(it.node_count / base_nodes, 1.0 / (depth - base_depth)) : 0;
+
+    if (it.completed) principalVariation<kBoardSize>(ctx, board, hash, player, depth, r, c, &it.pv);
+    ctx->iterations.push_back(it);
+    if (it.completed && ctx->on_iteration) ctx->on_iteration(it);
+}
+
+template <int kBoardSize>
+void RenjuAINegamax::principalVariation(RenjuAISearchContext *ctx, RenjuAIBoard *board,
+                                        RenjuAIUtils::SymmetricHash hash,
+                                        int player, int depth, int move_r, int move_c,
+                                        std::vector<std::pair<int, int>> *pv) {
+    // Follow best moves stored in the transposition table
+    int length = 0;
+    for (; length < depth; ++length) {
+        if (move_r < 0 || move_c < 0 || board->cell(move_r, move_c) != 0) break;
+        pv->push_back(std::make_pair(move_r, move_c));
+
+        board->makeMove<kBoardSize>(ctx, move_r, move_c, player);
+        RenjuAIUtils::zobristToggle<kBoardSize>(&hash, ctx->tt->zobrist_1, ctx->tt->zobrist_2, move_r, move_c, player);
+        player = player == 1 ? 2 : 1;
+
+        RenjuAITranspositionTable::Entry entry;
+        if (!ctx->tt->probe(hash, player, &entry)) {
+            ++length;
+            break;
+        }
+        move_r = entry.move_r; move_c = entry.move_c;
+    }
+    for (int i = 0; i < length; ++i) board->unmakeMove();
+}
 
-            // Times
-            std::clock_t c_iteration = (std::clock() - c_iteration_start) * 1000 / CLOCKS_PER_SEC;
-            std::clock_t c_elapsed = (std::clock() - c_start) * 1000 / CLOCKS_PER_SEC;
+bool RenjuAINegamax::followsHint(const RenjuAISearchContext *ctx, const RenjuAIBoard *board, int ply) {
+    if (ply >= static_cast<int>(ctx->pv_hint.size()) || board->moveCount() != ply) return false;
+    for (int i = 0; i < ply; ++i) {
+        if (board->move(i) != ctx->board_size * ctx->pv_hint[i].first + ctx->pv_hint[i].second) return false;
+    }
+    return true;
+}
 
-            if (c_elapsed + (c_iteration * kAvgBranchingFactor * kAvgBranchingFactor) > time_limit ||
-                d >= kMaximumDepth) {
-                if (actual_depth != nullptr) *actual_depth = d;
+void RenjuAINegamax::orderMoves(const RenjuAISearchContext *ctx, int ply, int player,
+                                Move *moves, int first, int size) {
+    const int *killers = &ctx->killers[kRenjuAiSearchKillerSlots * ply];
+    const unsigned int *history = &ctx->history[ctx->gs_size * (player - 1)];
+
+    // Heuristic values raised by history and killer bonuses
+    auto key = [&](const Move &move) {
+        int index = ctx->board_size * move.r + move.c;
+        int value = move.heuristic_val +
+                    static_cast<int>(std::min<unsigned int>(history[index] / kHistoryScale, kHistoryMaxBonus));
+        for (int k = 0; k < kRenjuAiSearchKillerSlots; ++k) {
+            if (killers[k] == index) {
+                value += kKillerBonus >> k;
                 break;
             }
         }
+        return value;
+    };
+
+    std::stable_sort(moves + first, moves + size, [&](const Move &a, const Move &b) { return key(a) > key(b); });
+}
+
+void RenjuAINegamax::moveToFront(Move *moves, int first, int size, int r, int c) {
+    for (int i = first + 1; i < size; ++i) {
+        if (moves[i].r == r && moves[i].c == c) {
+            std::rotate(moves + first, moves + i, moves + i + 1);
+            return;
+        }
     }
-    delete[] _gs;
 }
 
-int RenjuAINegamax::heuristicNegamax(char *gs, int player, int initial_depth, int depth,
+int RenjuAINegamax::searchBreadth(const RenjuAISearchContext *ctx, int level) {
+    if (ctx->breadth.empty()) return presetSearchBreadth[std::min(level, kRenjuAiSearchBreadthLevels - 1)];
+    return ctx->breadth[std::min(level, static_cast<int>(ctx->breadth.size()) - 1)];
+}
+
+int RenjuAINegamax::decayScore(int score) {
+    if (score >= 2) score = static_cast<int>(score * kScoreDecayFactor);
+    return score;
+}
+
+template <int kBoardSize>
+int RenjuAINegamax::heuristicNegamax(RenjuAISearchContext *ctx, RenjuAIBoard *board, MoveArena *arena,
+                                     const RenjuAIUtils::SymmetricHash &hash,
+                                     int player, int initial_depth, int depth, int num_threads,
                                      bool enable_ab_pruning, int alpha, int beta,
                                      int *move_r, int *move_c) {
     // Count node
-    ++g_node_count;
+    ++ctx->node_count;
 
     int max_score = INT_MIN;
     int opponent = player == 1 ? 2 : 1;
+    int alpha_original = alpha;
+    bool is_root = depth == initial_depth;
+
+    // Stop at the deadline, the caller discards this result.
+    // The root always runs until it has set its fallback move.
+    if (!is_root && ctx->checkDeadline()) return 0;
+
+    // Look up transposition table
+    // The root is always searched since it has to produce a move
+    RenjuAITranspositionTable::Entry tt_entry;
+    bool tt_hit = ctx->tt->probe(hash, player, &tt_entry);
+    ++ctx->tt_probes;
+    if (tt_hit) ++ctx->tt_hits;
+    if (tt_hit && !is_root && tt_entry.depth >= depth) {
+        int tt_score_decayed = decayScore(tt_entry.score);
+        if (tt_entry.bound == kRenjuAiTTBoundExact ||
+            (tt_entry.bound == kRenjuAiTTBoundLower && tt_score_decayed >= beta) ||
+            (tt_entry.bound == kRenjuAiTTBoundUpper && tt_entry.score <= alpha)) {
+            return tt_entry.score;
+        }
+    }
 
-    // Search and sort possible moves
-    std::vector<Move> moves_player, moves_opponent, candidate_moves;
-    searchMovesOrdered(gs, player, &moves_player);
-    searchMovesOrdered(gs, opponent, &moves_opponent);
+    // Set breadth
+    int breadth = searchBreadth(ctx, (initial_depth >> 1) - ((depth + 1) >> 1));
+
+    // Search possible moves, only the moves used below are sorted
+    int ply = initial_depth - depth;
+    Move *moves_player = arena->playerMoves(ply);
+    Move *moves_opponent = arena->opponentMoves(ply);
+    Move *candidate_moves = arena->candidateMoves(ply);
+    int moves_player_size = searchMovesOrdered<kBoardSize>(ctx, board, player, breadth, moves_player);
+    int moves_opponent_size = searchMovesOrdered<kBoardSize>(ctx, board, opponent, 2, moves_opponent);
+    int size = 0;
 
     // End if no move could be performed
-    if (moves_player.size() == 0) return 0;
+    if (moves_player_size == 0) return 0;
 
     // End directly if only one move or a winning move is found
-    if (moves_player.size() == 1 || moves_player[0].heuristic_val >= kRenjuAiEvalWinningScore) {
+    if (moves_player_size == 1 || moves_player[0].heuristic_val >= kRenjuAiEvalWinningScore) {
         auto move = moves_player[0];
         if (move_r != nullptr) *move_r = move.r;
         if (move_c != nullptr) *move_c = move.c;
@@ -121,87 +418,129 @@ int RenjuAINegamax::heuristicNegamax(char *gs, int player, int initial_depth, in
 
     // If opponent has threatening moves, consider blocking them first
     bool block_opponent = false;
-    int tmp_size = std::min(static_cast<int>(moves_opponent.size()), 2);
+    int tmp_size = std::min(moves_opponent_size, 2);
     if (moves_opponent[0].heuristic_val >= kRenjuAiEvalThreateningScore) {
         block_opponent = true;
         for (int i = 0; i < tmp_size; ++i) {
             auto move = moves_opponent[i];
 
             // Re-evaluate move as current player
-            move.heuristic_val = RenjuAIEval::evalMove(gs, move.r, move.c, player);
+            move.heuristic_val = board->score(player, move.r, move.c);
 
             // Add to candidate list
-            candidate_moves.push_back(move);
+            candidate_moves[size++] = move;
         }
     }
 
-    // Set breadth
-    int breadth = (initial_depth >> 1) - ((depth + 1) >> 1);
-    if (breadth > 4) breadth = presetSearchBreadth[4];
-    else             breadth = presetSearchBreadth[breadth];
-
     // Copy moves for current player
-    tmp_size = std::min(static_cast<int>(moves_player.size()), breadth);
+    tmp_size = std::min(moves_player_size, breadth);
     for (int i = 0; i < tmp_size; ++i)
-        candidate_moves.push_back(moves_player[i]);
+        candidate_moves[size++] = moves_player[i];
+
+    // Blocking moves keep their positions for the fallback below
+    int first = block_opponent ? std::min(moves_opponent_size, 2) : 0;
+
+    // Refine the static order with moves that caused cut-offs elsewhere in the tree
+    orderMoves(ctx, ply, player, candidate_moves, first, size);
+
+    // Search the best move from a previous search first, the transposition table is preferred
+    // over the previous principal variation
+    if (followsHint(ctx, board, ply)) {
+        moveToFront(candidate_moves, first, size, ctx->pv_hint[ply].first, ctx->pv_hint[ply].second);
+    }
+    if (tt_hit && tt_entry.move_r >= 0) {
+        moveToFront(candidate_moves, first, size, tt_entry.move_r, tt_entry.move_c);
+    }
 
       // Print heuristic values for debugging
 //    if (depth >= 8) {
-//        for (int i = 0; i < moves_player.size(); ++i) {
+//        for (int i = 0; i < moves_player_size; ++i) {
 //            auto move = moves_player[i];
 //            std::cout << depth << " | " << move.r << ", " << move.c << ": " << move.heuristic_val << std::endl;
 //        }
 //    }
 
     // Loop through every move
-    int size = static_cast<int>(candidate_moves.size());
-    for (int i = 0; i < size; ++i) {
-        auto move = candidate_moves[i];
+    int best_r = -1, best_c = -1;
+    bool cut_off = false;
 
-        // Execute move
-        RenjuAIUtils::setCell(gs, move.r, move.c, static_cast<char>(player));
+    // Moves of the root are split between threads
+    bool parallel = is_root && num_threads > 1 && size > 1;
 
-        // Run negamax recursively
-        int score = 0;
-        if (depth > 1) score = heuristicNegamax(gs,                 // Game state
-                                                opponent,           // Change player
-                                                initial_depth,      // Initial depth
-                                                depth - 1,          // Reduce depth by 1
-                                                enable_ab_pruning,  // Alpha-Beta
-                                                -beta,              //
-                                                -alpha + move.heuristic_val,
-                                                nullptr,            // Result move not required
-                                                nullptr);
-
-        // Closer moves get more score
-        if (score >= 2) score = static_cast<int>(score * kScoreDecayFactor);
+    // The first candidate is played if the search is aborted before any move is scored
+    if (is_root) {
+        if (move_r != nullptr) *move_r = candidate_moves[0].r;
+        if (move_c != nullptr) *move_c = candidate_moves[0].c;
+    }
 
-        // Calculate score difference
-        move.actual_score = move.heuristic_val - score;
+    // The fallback below compares the exact score of the first blocking move,
+    // the root searches it with a full window even within an aspiration window
+    int exact = is_root && block_opponent ? 1 : 0;
+    if (parallel && exact > 0) {
+        candidate_moves[0].actual_score = searchMove<kBoardSize>(ctx, board, arena, hash, player,
+                                                                 initial_depth, depth, enable_ab_pruning,
+                                                                 INT_MIN / 2, INT_MAX / 2, candidate_moves[0]);
+    }
+    if (parallel) {
+        int parallel_alpha = exact > 0 ? std::max(alpha, candidate_moves[0].actual_score) : alpha;
+        searchMovesParallel<kBoardSize>(ctx, board, hash, player, initial_depth, depth, num_threads,
+                                        enable_ab_pruning, parallel_alpha, beta,
+                                        candidate_moves + exact, size - exact);
+    }
 
-        // Store back to candidate array
-        candidate_moves[i].actual_score = move.actual_score;
+    for (int i = 0; i < size; ++i) {
+        // Execute move and search.
+        // Principal variation search: moves after the first are only tested against alpha
+        // with a null window and searched again with the full window if they score higher.
+        if (!parallel) {
+            auto &move = candidate_moves[i];
+            bool scout = enable_ab_pruning && i >= std::max(exact, 1) && depth > 1;
+            int move_alpha = i < exact ? INT_MIN / 2 : alpha;
+            int move_beta = i < exact ? INT_MAX / 2 : beta;
+            move.actual_score = searchMove<kBoardSize>(ctx, board, arena, hash, player, initial_depth, depth,
+                                                       enable_ab_pruning, move_alpha, move_beta, move, scout);
+            if (scout && !ctx->aborted && move.actual_score > alpha && decayScore(move.actual_score) < beta) {
+                ++ctx->re_searches;
+                move.actual_score = searchMove<kBoardSize>(ctx, board, arena, hash, player, initial_depth, depth,
+                                                           enable_ab_pruning, alpha, beta, move);
+            }
+            if (ctx->aborted) break;
+        }
+        auto move = candidate_moves[i];
 
         // Print actual scores for debugging
 //        if (depth >= 8)
 //            std::cout << depth << " | " << move.r << ", " << move.c << ": " << move.actual_score << std::endl;
 
-        // Restore
-        RenjuAIUtils::setCell(gs, move.r, move.c, 0);
-
         // Update maximum score
         if (move.actual_score > max_score) {
             max_score = move.actual_score;
+            best_r = move.r; best_c = move.c;
             if (move_r != nullptr) *move_r = move.r;
             if (move_c != nullptr) *move_c = move.c;
         }
 
         // Alpha-beta
-        int max_score_decayed = max_score;
-        if (max_score >= 2) max_score_decayed = static_cast<int>(max_score_decayed * kScoreDecayFactor);
         if (max_score > alpha) alpha = max_score;
-        if (enable_ab_pruning && max_score_decayed >= beta) break;
+        if (enable_ab_pruning && decayScore(max_score) >= beta) {
+            cut_off = true;
+            ++ctx->beta_cutoffs;
+            if (i == 0) ++ctx->first_move_cutoffs;
+            ctx->addCutoff(ply, depth, player, move.r, move.c);
+            break;
+        }
+    }
+
+    // Incomplete results are neither stored nor used, a neutral score keeps the caller's arithmetic in range
+    if (ctx->aborted) return 0;
+
+    // Store result, scores are exact if nothing was pruned
+    int bound = kRenjuAiTTBoundExact;
+    if (enable_ab_pruning) {
+        if (cut_off) bound = kRenjuAiTTBoundLower;
+        else if (max_score <= alpha_original) bound = kRenjuAiTTBoundUpper;
     }
+    ctx->tt->store(hash, player, depth, bound, max_score, best_r, best_c);
 
     // If no moves that are much better than blocking threatening moves, block them.
     // This attempts blocking even winning is impossible if the opponent plays optimally.
@@ -218,79 +557,173 @@ int RenjuAINegamax::heuristicNegamax(char *gs, int player, int initial_depth, in
     return max_score;
 }
 
-void RenjuAINegamax::searchMovesOrdered(const char *gs, int player, std::vector<Move> *result) {
-    // Clear and previous result
-    result->clear();
-
-    // Find an extent to reduce unnecessary calls to RenjuAIUtils::remoteCell
-    int min_r = INT_MAX, min_c = INT_MAX, max_r = INT_MIN, max_c = INT_MIN;
-    for (int r = 0; r < g_board_size; ++r) {
-        for (int c = 0; c < g_board_size; ++c) {
-            if (gs[g_board_size * r + c] != 0) {
-                if (r < min_r) min_r = r;
-                if (c < min_c) min_c = c;
-                if (r > max_r) max_r = r;
-                if (c > max_c) max_c = c;
+template <int kBoardSize>
+int RenjuAINegamax::searchMove(RenjuAISearchContext *ctx, RenjuAIBoard *board, MoveArena *arena,
+                               RenjuAIUtils::SymmetricHash hash,
+                               int player, int initial_depth, int depth,
+                               bool enable_ab_pruning, int alpha, int beta, const Move &move, bool scout) {
+    // Execute move
+    board->makeMove<kBoardSize>(ctx, move.r, move.c, player);
+    RenjuAIUtils::zobristToggle<kBoardSize>(&hash, ctx->tt->zobrist_1, ctx->tt->zobrist_2, move.r, move.c, player);
+
+    // Run negamax recursively
+    int score = 0;
+    if (depth > 1) score = heuristicNegamax<kBoardSize>(ctx,                  // Search context
+                                                        board,                // Game state
+                                                        arena,                // Move lists
+                                                        hash,                 // Hash of the new state
+                                                        player == 1 ? 2 : 1,  // Change player
+                                                        initial_depth,        // Initial depth
+                                                        depth - 1,            // Reduce depth by 1
+                                                        1,                    // Only the root is split
+                                                        enable_ab_pruning,    // Alpha-Beta
+                                                        scout ? -alpha + move.heuristic_val - 1 : -beta,
+                                                        -alpha + move.heuristic_val,
+                                                        nullptr,              // Result move not required
+                                                        nullptr);
+
+    // Closer moves get more score
+    score = decayScore(score);
+
+    // Restore
+    board->unmakeMove();
+
+    // Calculate score difference
+    return move.heuristic_val - score;
+}
+
+template <int kBoardSize>
+void RenjuAINegamax::searchMovesParallel(RenjuAISearchContext *ctx, const RenjuAIBoard *board,
+                                         const RenjuAIUtils::SymmetricHash &hash,
+                                         int player, int initial_depth, int depth, int num_threads,
+                                         bool enable_ab_pruning, int alpha, int beta,
+                                         Move *moves, int size) {
+    std::atomic<int> next_move(0);
+    std::atomic<int> shared_alpha(alpha);
+    std::atomic<bool> cut_off(false);
+    RenjuAISearchContext *first_move_ctx = nullptr;
+
+    // Moves skipped after a cut-off are never chosen
+    for (int i = 0; i < size; ++i) moves[i].actual_score = INT_MIN;
+
+    auto search = [&](RenjuAISearchContext *thread_ctx) {
+        RenjuAIBoard _board(*board);
+        _board.reserve(initial_depth);
+        MoveArena _arena(thread_ctx, initial_depth);
+        while (!cut_off) {
+            int i = next_move++;
+            if (i >= size) break;
+            if (i == 0) first_move_ctx = thread_ctx;
+
+            Move &move = moves[i];
+            int score = searchMove<kBoardSize>(thread_ctx, &_board, &_arena, hash, player, initial_depth, depth,
+                                               enable_ab_pruning, shared_alpha, beta, move);
+
+            // Stop all threads at the deadline, the move stays unscored
+            if (thread_ctx->aborted) {
+                cut_off = true;
+                break;
             }
-        }
-    }
+            move.actual_score = score;
 
-    if (min_r - 2 < 0) min_r = 2;
-    if (min_c - 2 < 0) min_c = 2;
-    if (max_r + 2 >= g_board_size) max_r = g_board_size - 3;
-    if (max_c + 2 >= g_board_size) max_c = g_board_size - 3;
+            // Raise alpha for moves searched later
+            int a = shared_alpha;
+            while (move.actual_score > a && !shared_alpha.compare_exchange_weak(a, move.actual_score)) {}
 
-    // Loop through all cells
-    for (int r = min_r - 2; r <= max_r + 2; ++r) {
-        for (int c = min_c - 2; c <= max_c + 2; ++c) {
-            // Consider only empty cells
-            if (gs[g_board_size * r + c] != 0) continue;
-
-            // Skip remote cells (no pieces within 2 cells)
-            if (RenjuAIUtils::remoteCell(gs, r, c)) continue;
+            if (enable_ab_pruning && decayScore(move.actual_score) >= beta) cut_off = true;
+        }
+    };
+
+    // Each worker has its own context with fresh counters, move ordering starts from the current tables
+    int num_workers = std::min(num_threads, size) - 1;
+    std::vector<unsigned int> history_begin;
+    if (num_workers > 0) history_begin = ctx->history;
+    std::vector<RenjuAISearchContext> worker_ctx(num_workers, *ctx);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_workers; ++i) {
+        worker_ctx[i].resetCounters();
+        workers.emplace_back([&search, &worker_ctx, i]() {
+            // The search phase is the wall time of the calling thread, only inner phases are added
+            RenjuAIPhaseProfiler::Counters phases_begin = RenjuAIPhaseProfiler::threadCounters();
+            search(&worker_ctx[i]);
+            worker_ctx[i].phases.add(RenjuAIPhaseProfiler::threadCounters().since(phases_begin));
+        });
+    }
 
-            Move m;
-            m.r = r;
-            m.c = c;
+    // The current thread searches along with the workers
+    search(ctx);
+    for (auto &worker : workers) worker.join();
 
-            // Evaluate move
-            m.heuristic_val = RenjuAIEval::evalMove(gs, r, c, player);
+    // Collect counters and the history added by workers, killers follow the line of the first move
+    for (auto &c : worker_ctx) {
+        ctx->addCounters(c);
+        if (c.aborted) ctx->aborted = true;
+        for (size_t i = 0; i < ctx->history.size(); ++i) ctx->history[i] += c.history[i] - history_begin[i];
+    }
+    if (first_move_ctx != nullptr && first_move_ctx != ctx) ctx->killers = first_move_ctx->killers;
+}
 
-            // Add move
-            result->push_back(m);
+template <int kBoardSize>
+int RenjuAINegamax::searchMovesOrdered(RenjuAISearchContext *ctx, const RenjuAIBoard *board, int player,
+                                       int count, Move *result) {
+    const int board_size = RenjuAIUtils::boardSize<kBoardSize>(ctx->board_size);
+    int size = 0;
+
+    // Walk candidate cells (empty and within 2 cells of a piece) in row-major order
+    {
+        RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseMoveGeneration);
+        for (int r = 0; r < board_size; ++r) {
+            for (uint32_t row = board->candidates(r); row != 0; row &= row - 1) {
+                Move m;
+                m.r = r;
+                m.c = __builtin_ctz(row);
+
+                // Evaluate move (kept up to date by the board)
+                m.heuristic_val = board->score(player, m.r, m.c);
+
+                // Add move
+                result[size++] = m;
+            }
         }
     }
-    std::sort(result->begin(), result->end());
+
+    // Sort only the best moves
+    RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseSorting);
+    count = std::min(count, size);
+    std::partial_sort(result, result + count, result + size);
+    return size;
 }
 
-int RenjuAINegamax::negamax(char *gs, int player, int depth, int *move_r, int *move_c) {
+int RenjuAINegamax::negamax(RenjuAISearchContext *ctx, char *gs, int player, int depth, int *move_r, int *move_c) {
     // Initialize with a minimum score
     int max_score = INT_MIN;
+    int board_size = ctx->board_size;
 
     // Eval game state
-    if (depth == 0) return RenjuAIEval::evalState(gs, player);
+    if (depth == 0) return RenjuAIEval::evalState(ctx, gs, player);
 
     // Loop through all cells
-    for (int r = 0; r < g_board_size; ++r) {
-        for (int c = 0; c < g_board_size; ++c) {
+    for (int r = 0; r < board_size; ++r) {
+        for (int c = 0; c < board_size; ++c) {
             // Consider only empty cells
-            if (RenjuAIUtils::getCell(gs, r, c) != 0) continue;
+            if (RenjuAIUtils::getCell(gs, board_size, r, c) != 0) continue;
 
             // Skip remote cells (no pieces within 2 cells)
-            if (RenjuAIUtils::remoteCell(gs, r, c)) continue;
+            if (RenjuAIUtils::remoteCell(gs, board_size, r, c)) continue;
 
             // Execute move
-            RenjuAIUtils::setCell(gs, r, c, static_cast<char>(player));
+            RenjuAIUtils::setCell(gs, board_size, r, c, static_cast<char>(player));
 
             // Run negamax recursively
-            int s = -negamax(gs,                   // Game state
+            int s = -negamax(ctx,                  // Search context
+                             gs,                   // Game state
                              player == 1 ? 2 : 1,  // Change player
                              depth - 1,            // Reduce depth by 1
                              nullptr,              // Result move not required
                              nullptr);
 
             // Restore
-            RenjuAIUtils::setCell(gs, r, c, 0);
+            RenjuAIUtils::setCell(gs, board_size, r, c, 0);
 
             // Update max score
             if (s > max_score) {
@@ -302,3 +735,11 @@ int RenjuAINegamax::negamax(char *gs, int player, int depth, int *move_r, int *m
     }
     return max_score;
 }
+
+// Searches specialised for the Gomocup and CLI board sizes, 0 reads the board size at runtime
+template void RenjuAINegamax::heuristicNegamax<0>(RenjuAISearchContext *, const char *, int, int, int, int, bool,
+                                                  int *, int *, int *);
+template void RenjuAINegamax::heuristicNegamax<15>(RenjuAISearchContext *, const char *, int, int, int, int, bool,
+                                                   int *, int *, int *);
+template void RenjuAINegamax::heuristicNegamax<19>(RenjuAISearchContext *, const char *, int, int, int, int, bool,
+                                                   int *, int *, int *);
@@ -0,0 +1,189 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/opening_book.h>
+#include <ai/utils.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char RenjuAIOpeningBook::kMagic[8] = {'B', 'L', 'U', 'P', 'I', 'G', 'B', 'K'};
+
+static_assert(sizeof(RenjuAIOpeningBook::Entry) == 16, "Book entries are 16 bytes");
+
+RenjuAIOpeningBook::RenjuAIOpeningBook() {
+    data = nullptr;
+    data_size = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+RenjuAIOpeningBook::~RenjuAIOpeningBook() {
+    close();
+}
+
+bool RenjuAIOpeningBook::open(const char *path) {
+    close();
+    if (path == nullptr) return false;
+
+#ifdef _WIN32
+    // No mapping, the file is read into memory
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::vector<char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    data_size = buffer.size();
+    data = new char[data_size];
+    memcpy(data, buffer.data(), data_size);
+#else
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        ::close(fd);
+        return false;
+    }
+    data_size = static_cast<size_t>(st.st_size);
+    void *mapped = mmap(nullptr, data_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        data_size = 0;
+        return false;
+    }
+    data = mapped;
+#endif
+
+    // Validate header
+    Header header;
+    bool valid = data_size >= sizeof(Header);
+    if (valid) {
+        memcpy(&header, data, sizeof(Header));
+        valid = memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                header.version == kRenjuAiBookVersion &&
+                header.entry_size == sizeof(Entry) &&
+                header.count <= (data_size - sizeof(Header)) / sizeof(Entry);
+    }
+    if (!valid) {
+        close();
+        return false;
+    }
+
+    entries = reinterpret_cast<const Entry *>(static_cast<const char *>(data) + sizeof(Header));
+    count = header.count;
+    return true;
+}
+
+void RenjuAIOpeningBook::close() {
+    if (data != nullptr) {
+#ifdef _WIN32
+        delete[] static_cast<char *>(data);
+#else
+        munmap(data, data_size);
+#endif
+    }
+    data = nullptr;
+    data_size = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+bool RenjuAIOpeningBook::lookup(const char *gs, int board_size, int player, int *move_r, int *move_c) const {
+    if (entries == nullptr || gs == nullptr || board_size < 1 || board_size > 20) return false;
+
+    int symmetry;
+    uint64_t k = key(gs, board_size, player, &symmetry);
+
+    // Binary search
+    const Entry *end = entries + count;
+    const Entry *it = std::lower_bound(entries, end, k,
+                                       [](const Entry &e, uint64_t k) { return e.key < k; });
+    if (it == end || it->key != k || it->board_size != board_size) return false;
+
+    // Map the move back to the orientation of the game state
+    int r, c;
+    RenjuAIUtils::inverseSymmetricCell(board_size, symmetry, it->move_r, it->move_c, &r, &c);
+    if (r >= board_size || c >= board_size || RenjuAIUtils::getCell(gs, board_size, r, c) != 0) return false;
+    *move_r = r;
+    *move_c = c;
+    return true;
+}
+
+uint64_t RenjuAIOpeningBook::key(const char *gs, int board_size, int player, int *symmetry) {
+    // Stones of the player to move are hashed with the keys of black
+    const ZobristKeys &z = zobristKeys();
+    RenjuAIUtils::SymmetricHash hash;
+    if (player == 1) RenjuAIUtils::zobristHash(gs, board_size, z.own, z.opponent, &hash);
+    else             RenjuAIUtils::zobristHash(gs, board_size, z.opponent, z.own, &hash);
+    return hash.canonical(symmetry) ^ static_cast<uint64_t>(board_size) * 0x9e3779b97f4a7c15ULL;
+}
+
+RenjuAIOpeningBook::Entry RenjuAIOpeningBook::makeEntry(const char *gs, int board_size, int player,
+                                                        int move_r, int move_c, int depth) {
+    Entry entry;
+    int symmetry, r, c;
+    entry.key = key(gs, board_size, player, &symmetry);
+    RenjuAIUtils::symmetricCell(board_size, symmetry, move_r, move_c, &r, &c);
+    entry.board_size = static_cast<uint8_t>(board_size);
+    entry.move_r = static_cast<uint8_t>(r);
+    entry.move_c = static_cast<uint8_t>(c);
+    entry.depth = static_cast<uint8_t>(depth);
+    entry.reserved = 0;
+    return entry;
+}
+
+bool RenjuAIOpeningBook::write(const char *path, std::vector<Entry> entries) {
+    // Sort by key and remove duplicates, keeping the first entry of each key
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry &a, const Entry &b) { return a.key < b.key; });
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                              [](const Entry &a, const Entry &b) { return a.key == b.key; }),
+                  entries.end());
+
+    Header header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kRenjuAiBookVersion;
+    header.entry_size = sizeof(Entry);
+    header.count = entries.size();
+    header.reserved = 0;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    if (!entries.empty())
+        file.write(reinterpret_cast<const char *>(entries.data()),
+                   static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+    return static_cast<bool>(file);
+}
+
+RenjuAIOpeningBook::ZobristKeys::ZobristKeys() {
+    RenjuAIUtils::zobristInit(kRenjuAiBookZobristSize, own, opponent, kRenjuAiBookZobristSeed);
+}
+
+const RenjuAIOpeningBook::ZobristKeys &RenjuAIOpeningBook::zobristKeys() {
+    // Generated once, on first use
+    static const ZobristKeys keys;
+    return keys;
+}
@@ -0,0 +1,69 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/phase_profiler.h>
+#include <cstdio>
+
+std::atomic<bool> RenjuAIPhaseProfiler::enabled_flag(false);
+thread_local RenjuAIPhaseProfiler::Counters RenjuAIPhaseProfiler::thread_counters;
+
+static const char *const kPhaseNames[kRenjuAiPhaseCount] = {
+    "search", "threat_solver", "board_update", "move_generation", "sorting", "eval_move", "pattern_match",
+    "remote_cell"};
+
+void RenjuAIPhaseProfiler::Counters::clear() {
+    for (int i = 0; i < kRenjuAiPhaseCount; ++i) {
+        cycles[i] = 0;
+        calls[i] = 0;
+    }
+}
+
+void RenjuAIPhaseProfiler::Counters::add(const Counters &other) {
+    for (int i = 0; i < kRenjuAiPhaseCount; ++i) {
+        cycles[i] += other.cycles[i];
+        calls[i] += other.calls[i];
+    }
+}
+
+RenjuAIPhaseProfiler::Counters RenjuAIPhaseProfiler::Counters::since(const Counters &begin) const {
+    Counters result;
+    for (int i = 0; i < kRenjuAiPhaseCount; ++i) {
+        result.cycles[i] = cycles[i] - begin.cycles[i];
+        result.calls[i] = calls[i] - begin.calls[i];
+    }
+    return result;
+}
+
+void RenjuAIPhaseProfiler::setEnabled(bool enabled) {
+    enabled_flag = enabled;
+}
+
+const char *RenjuAIPhaseProfiler::phaseName(int phase) {
+    return phase >= 0 && phase < kRenjuAiPhaseCount ? kPhaseNames[phase] : "";
+}
+
+std::string RenjuAIPhaseProfiler::toString(const Counters &counters) {
+    uint64_t total = counters.cycles[kRenjuAiPhaseSearch];
+    std::string result = "cycles=" + std::to_string(total);
+    for (int i = kRenjuAiPhaseSearch + 1; i < kRenjuAiPhaseCount; ++i) {
+        char share[32];
+        snprintf(share, sizeof(share), "%.1f%%", total > 0 ? 100.0 * counters.cycles[i] / total : 0.0);
+        result += std::string(" ") + kPhaseNames[i] + "=" + share + "/" + std::to_string(counters.calls[i]);
+    }
+    return result;
+}
@@ -0,0 +1,172 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/profile.h>
+#include <ai/eval.h>
+#include <ai/negamax.h>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+RenjuAIProfile::RenjuAIProfile() {
+    name = "default";
+    breadth.assign(RenjuAINegamax::presetSearchBreadth,
+                   RenjuAINegamax::presetSearchBreadth + kRenjuAiSearchBreadthLevels);
+    pattern_scores.assign(RenjuAIEval::presetScores, RenjuAIEval::presetScores + kRenjuAiEvalPatterns);
+}
+
+RenjuAIProfile::~RenjuAIProfile() {}
+
+bool RenjuAIProfile::builtIn(const std::string &name, RenjuAIProfile *profile) {
+    RenjuAIProfile p;
+    if (name == "fast") {
+        // Casual games, answers in a fraction of the default time
+        p.breadth = {11, 5, 3, 3, 2};
+    } else if (name == "tournament") {
+        // Long time controls, wider near the root where misses cost the most
+        p.breadth = {21, 9, 6, 4, 3};
+    } else if (name != "default") {
+        return false;
+    }
+    p.name = name;
+    *profile = p;
+    return true;
+}
+
+bool RenjuAIProfile::parse(const std::string &text, RenjuAIProfile *profile, std::string *error) {
+    RenjuAIProfile p;
+    std::istringstream lines(text);
+    std::string line;
+    for (int line_number = 1; std::getline(lines, line); ++line_number) {
+        size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == std::string::npos || line[begin] == '#') continue;
+
+        size_t separator = line.find('=');
+        if (separator == std::string::npos) {
+            *error = "Line " + std::to_string(line_number) + ": expected key = value";
+            return false;
+        }
+        std::string key = trim(line.substr(0, separator));
+        std::string value = trim(line.substr(separator + 1));
+
+        bool valid;
+        if (key == "base") {
+            valid = builtIn(value, &p);
+        } else if (key == "name") {
+            p.name = value;
+            valid = !value.empty();
+        } else if (key == "breadth") {
+            valid = parseValues(value, &p.breadth);
+        } else if (key == "patterns") {
+            valid = parseValues(value, &p.pattern_scores);
+        } else {
+            *error = "Line " + std::to_string(line_number) + ": unknown key " + key;
+            return false;
+        }
+        if (!valid) {
+            *error = "Line " + std::to_string(line_number) + ": invalid " + key;
+            return false;
+        }
+    }
+
+    if (!p.validate(error)) return false;
+    *profile = p;
+    return true;
+}
+
+bool RenjuAIProfile::load(const std::string &name_or_path, RenjuAIProfile *profile, std::string *error) {
+    if (builtIn(name_or_path, profile)) return true;
+
+    std::ifstream file(name_or_path);
+    if (!file) {
+        *error = "No built-in profile or file " + name_or_path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    if (parse(text.str(), profile, error)) return true;
+    *error = name_or_path + ": " + *error;
+    return false;
+}
+
+bool RenjuAIProfile::validate(std::string *error) const {
+    if (breadth.empty()) {
+        *error = "No breadth";
+        return false;
+    }
+    for (size_t i = 0; i < breadth.size(); ++i) {
+        if (breadth[i] < 1 || breadth[i] > kRenjuAiProfileMaxBreadth) {
+            *error = "Breadth " + std::to_string(i) + " is not 1 to " + std::to_string(kRenjuAiProfileMaxBreadth);
+            return false;
+        }
+    }
+
+    if (pattern_scores.size() != kRenjuAiEvalPatterns) {
+        *error = "Expected " + std::to_string(kRenjuAiEvalPatterns) + " pattern scores";
+        return false;
+    }
+    for (int i = 0; i < kRenjuAiEvalPatterns; ++i) {
+        int score = pattern_scores[static_cast<size_t>(i)];
+        int min = i == 0 ? kRenjuAiEvalWinningScore : i < kRenjuAiEvalThreateningPatterns ?
+                  kRenjuAiEvalThreateningScore : 0;
+        int max = i == 0 ? kRenjuAiEvalWinningScore * 10 : i < kRenjuAiEvalThreateningPatterns ?
+                  kRenjuAiEvalWinningScore - 1 : kRenjuAiEvalThreateningScore - 1;
+        if (score < min || score > max) {
+            *error = "Pattern score " + std::to_string(i) + " is not " + std::to_string(min) + " to " +
+                     std::to_string(max);
+            return false;
+        }
+    }
+    return true;
+}
+
+void RenjuAIProfile::apply(RenjuAISearchContext *ctx) const {
+    ctx->breadth = breadth;
+    ctx->adm_scores = RenjuAIEval::scoreTable(pattern_scores);
+}
+
+std::string RenjuAIProfile::toString() const {
+    return "name = " + name + "\nbreadth = " + join(breadth) + "\npatterns = " + join(pattern_scores) + "\n";
+}
+
+std::string RenjuAIProfile::join(const std::vector<int> &values) {
+    std::string result;
+    for (size_t i = 0; i < values.size(); ++i) result += (i > 0 ? "," : "") + std::to_string(values[i]);
+    return result;
+}
+
+std::string RenjuAIProfile::trim(const std::string &text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) return "";
+    return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+}
+
+bool RenjuAIProfile::parseValues(const std::string &text, std::vector<int> *values) {
+    values->clear();
+    std::istringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        item = trim(item);
+        char *end = nullptr;
+        long value = strtol(item.c_str(), &end, 10);
+        if (item.empty() || *end != 0 || value < INT_MIN || value > INT_MAX) return false;
+        values->push_back(static_cast<int>(value));
+    }
+    return !values->empty();
+}
@@ -0,0 +1,141 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/result_cache.h>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+RenjuAIResultCache::RenjuAIResultCache(size_t capacity) {
+    max_size = capacity > 0 ? capacity : 1;
+    hit_count = miss_count = 0;
+    RenjuAIUtils::zobristInit(kRenjuAiTTZobristSize, zobrist_1, zobrist_2);
+}
+
+RenjuAIResultCache::~RenjuAIResultCache() {}
+
+bool RenjuAIResultCache::lookup(const char *gs, int board_size, const Params &params, Result *result) {
+    std::string state;
+    int symmetry;
+    uint64_t k = key(gs, board_size, params, &state, &symmetry);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = find(k, state, params);
+    if (it == items.end()) {
+        ++miss_count;
+        return false;
+    }
+    ++hit_count;
+
+    // Mark as most recently used
+    items.splice(items.begin(), items, it);
+
+    *result = it->result;
+    if (result->move_r >= 0 && result->move_c >= 0)
+        RenjuAIUtils::inverseSymmetricCell(board_size, symmetry, it->result.move_r, it->result.move_c,
+                                           &result->move_r, &result->move_c);
+    return true;
+}
+
+void RenjuAIResultCache::store(const char *gs, int board_size, const Params &params, const Result &result) {
+    Item item;
+    int symmetry;
+    item.key = key(gs, board_size, params, &item.state, &symmetry);
+    item.params = params;
+    item.result = result;
+    if (result.move_r >= 0 && result.move_c >= 0)
+        RenjuAIUtils::symmetricCell(board_size, symmetry, result.move_r, result.move_c,
+                                    &item.result.move_r, &item.result.move_c);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = find(item.key, item.state, params);
+    if (it != items.end()) {
+        it->result = item.result;
+        items.splice(items.begin(), items, it);
+        return;
+    }
+
+    // Drop the least recently used item
+    if (items.size() >= max_size) {
+        auto last = std::prev(items.end());
+        auto range = index.equal_range(last->key);
+        for (auto i = range.first; i != range.second; ++i) {
+            if (i->second == last) {
+                index.erase(i);
+                break;
+            }
+        }
+        items.pop_back();
+    }
+
+    items.push_front(std::move(item));
+    index.insert(std::make_pair(items.front().key, items.begin()));
+}
+
+void RenjuAIResultCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    items.clear();
+    index.clear();
+}
+
+size_t RenjuAIResultCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return items.size();
+}
+
+uint64_t RenjuAIResultCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hit_count;
+}
+
+uint64_t RenjuAIResultCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return miss_count;
+}
+
+uint64_t RenjuAIResultCache::key(const char *gs, int board_size, const Params &params,
+                                 std::string *state, int *symmetry) const {
+    RenjuAIUtils::SymmetricHash hash;
+    RenjuAIUtils::zobristHash(gs, board_size, zobrist_1, zobrist_2, &hash);
+    uint64_t k = hash.canonical(symmetry);
+
+    // States are kept packed, 2 bits per cell
+    std::vector<char> symmetric_gs(static_cast<size_t>(board_size * board_size));
+    RenjuAIUtils::symmetricState(gs, board_size, *symmetry, symmetric_gs.data());
+    state->resize(static_cast<size_t>(RenjuAIUtils::packedSize(board_size)));
+    RenjuAIUtils::packState(symmetric_gs.data(), board_size, reinterpret_cast<uint8_t *>(&(*state)[0]));
+
+    // Mix in parameters
+    const int values[] = {board_size, params.player, params.search_depth, params.time_limit, params.num_threads,
+                          params.profile};
+    for (int v : values) k = (k ^ static_cast<uint64_t>(static_cast<uint32_t>(v))) * 0x100000001b3ULL;
+    return k;
+}
+
+std::list<RenjuAIResultCache::Item>::iterator RenjuAIResultCache::find(uint64_t key, const std::string &state,
+                                                                       const Params &params) {
+    auto range = index.equal_range(key);
+    for (auto i = range.first; i != range.second; ++i) {
+        const Item &item = *i->second;
+        if (item.state == state && item.params.player == params.player &&
+            item.params.search_depth == params.search_depth && item.params.time_limit == params.time_limit &&
+            item.params.num_threads == params.num_threads && item.params.profile == params.profile)
+            return i->second;
+    }
+    return items.end();
+}
@@ -0,0 +1,66 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/search_context.h>
+#include <ai/transposition_table.h>
+
+RenjuAISearchContext::RenjuAISearchContext(int board_size) {
+    this->board_size = board_size;
+    gs_size = static_cast<unsigned int>(board_size * board_size);
+    tt = nullptr;
+    tt_size_log2 = kRenjuAiTTDefaultSizeLog2;
+    session = nullptr;
+    adm_scores = nullptr;
+    history.assign(2 * gs_size, 0);
+    deadline = std::chrono::steady_clock::time_point::max();
+    stop = nullptr;
+    aborted = false;
+    resetCounters();
+}
+
+RenjuAISearchContext::~RenjuAISearchContext() {}
+
+void RenjuAISearchContext::resetKillers(int plies) {
+    killers.assign(static_cast<size_t>(kRenjuAiSearchKillerSlots * plies), -1);
+}
+
+void RenjuAISearchContext::resetCounters() {
+    node_count = 0;
+    eval_count = 0;
+    pm_count = 0;
+    beta_cutoffs = 0;
+    first_move_cutoffs = 0;
+    re_searches = 0;
+    tt_probes = 0;
+    tt_hits = 0;
+    threat_node_count = 0;
+    phases.clear();
+}
+
+void RenjuAISearchContext::addCounters(const RenjuAISearchContext &other) {
+    node_count += other.node_count;
+    eval_count += other.eval_count;
+    pm_count += other.pm_count;
+    beta_cutoffs += other.beta_cutoffs;
+    first_move_cutoffs += other.first_move_cutoffs;
+    re_searches += other.re_searches;
+    tt_probes += other.tt_probes;
+    tt_hits += other.tt_hits;
+    threat_node_count += other.threat_node_count;
+    phases.add(other.phases);
+}
@@ -0,0 +1,118 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/search_session.h>
+
+RenjuAISearchSession::RenjuAISearchSession(int tt_size_log2) : tt(tt_size_log2) {
+    board_size = 0;
+    player = 0;
+    piece_count = 0;
+    depth = 0;
+    time_ms = 0;
+    speculating = false;
+    saved_board_size = saved_player = saved_piece_count = saved_depth = 0;
+    saved_time_ms = 0;
+}
+
+RenjuAISearchSession::~RenjuAISearchSession() {}
+
+std::vector<std::pair<int, int>> RenjuAISearchSession::continuation(const char *gs, int board_size,
+                                                                    int player) const {
+    std::vector<std::pair<int, int>> rest;
+    if (pv.size() < 3 || board_size != this->board_size || player != this->player) return rest;
+
+    // Exactly the two moves of the variation have been played since
+    int opponent = player == 1 ? 2 : 1;
+    if (countPieces(gs, board_size) != piece_count + 2 ||
+        gs[board_size * pv[0].first + pv[0].second] != player ||
+        gs[board_size * pv[1].first + pv[1].second] != opponent) return rest;
+
+    rest.assign(pv.begin() + 2, pv.end());
+    return rest;
+}
+
+void RenjuAISearchSession::update(const char *gs, int board_size, int player, int depth, double time_ms,
+                                  const std::vector<std::pair<int, int>> &pv) {
+    this->board_size = board_size;
+    this->player = player;
+    piece_count = countPieces(gs, board_size);
+    this->depth = depth;
+    this->time_ms = time_ms;
+    this->pv = pv;
+}
+
+void RenjuAISearchSession::restoreOrdering(RenjuAISearchContext *ctx, const char *gs, int player) const {
+    if (ctx->board_size != board_size || history.size() != ctx->history.size()) return;
+
+    for (size_t i = 0; i < history.size(); ++i) ctx->history[i] = history[i] >> 1;
+
+    if (continuation(gs, ctx->board_size, player).empty()) return;
+    size_t shift = 2 * kRenjuAiSearchKillerSlots;
+    for (size_t i = 0; i + shift < killers.size() && i < ctx->killers.size(); ++i)
+        ctx->killers[i] = killers[i + shift];
+}
+
+void RenjuAISearchSession::saveOrdering(const RenjuAISearchContext &ctx) {
+    killers = ctx.killers;
+    history = ctx.history;
+}
+
+void RenjuAISearchSession::clear() {
+    tt.clear();
+    board_size = 0;
+    player = 0;
+    piece_count = 0;
+    depth = 0;
+    time_ms = 0;
+    pv.clear();
+    killers.clear();
+    history.clear();
+}
+
+void RenjuAISearchSession::beginSpeculation() {
+    speculating = true;
+    saved_board_size = board_size;
+    saved_player = player;
+    saved_piece_count = piece_count;
+    saved_depth = depth;
+    saved_time_ms = time_ms;
+    saved_pv = pv;
+    saved_killers = killers;
+    saved_history = history;
+}
+
+void RenjuAISearchSession::endSpeculation(bool keep) {
+    if (!speculating) return;
+    speculating = false;
+    if (keep) return;
+    board_size = saved_board_size;
+    player = saved_player;
+    piece_count = saved_piece_count;
+    depth = saved_depth;
+    time_ms = saved_time_ms;
+    pv.swap(saved_pv);
+    killers.swap(saved_killers);
+    history.swap(saved_history);
+}
+
+int RenjuAISearchSession::countPieces(const char *gs, int board_size) {
+    int count = 0;
+    for (int i = 0; i < board_size * board_size; ++i)
+        if (gs[i] != 0) ++count;
+    return count;
+}
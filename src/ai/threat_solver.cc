@@ -0,0 +1,255 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/threat_solver.h>
+#include <ai/phase_profiler.h>
+#include <algorithm>
+#include <cstring>
+
+// Steps of the orientations kRenjuAiBitboard*
+static const int kOrientationDR[4] = {0, 1, 1, 1};
+static const int kOrientationDC[4] = {1, 1, 0, -1};
+
+RenjuAIThreatSolver::State::State(RenjuAISearchContext *ctx, const RenjuAIBoard &board) : bits(board.bitboard()) {
+    this->ctx = ctx;
+    board_size = board.board_size;
+    cells.assign(board.gs(), board.gs() + board_size * board_size);
+    node_count = 0;
+    budget = 0;
+    next_check = 0;
+}
+
+bool RenjuAIThreatSolver::solve(RenjuAISearchContext *ctx, const RenjuAIBoard &board, int player,
+                                std::vector<std::pair<int, int>> *sequence) {
+    RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseThreatSolver);
+    State s(ctx, board);
+    int opponent = player == 1 ? 2 : 1;
+    sequence->clear();
+
+    uint32_t candidates[kRenjuAiBitboardMaxSize];
+    for (int r = 0; r < s.board_size; ++r) candidates[r] = board.candidates(r);
+
+    // Five in one move, or blocking a five of the opponent first
+    int forced = -1, opponent_fives = 0;
+    for (int r = 0; r < s.board_size; ++r) {
+        for (uint32_t bits = candidates[r]; bits != 0; bits &= bits - 1) {
+            int c = __builtin_ctz(bits);
+            if (makesFive(s, player, r, c)) {
+                sequence->push_back(std::make_pair(r, c));
+                return true;
+            }
+            if (makesFive(s, opponent, r, c)) {
+                forced = s.board_size * r + c;
+                ++opponent_fives;
+            }
+        }
+    }
+    if (opponent_fives >= 2) return false;
+
+    // Fours only
+    s.budget = kRenjuAiThreatSolverVCFBudget;
+    bool win = attack(&s, candidates, player, kRenjuAiThreatSolverVCFDepth, false, forced, sequence);
+    ctx->threat_node_count += static_cast<unsigned int>(s.node_count);
+    if (win) return true;
+
+    // Fours and threes with its own budget, deepened gradually since every answer to a three
+    // is searched. A three needs at least one more attacking move.
+    s.node_count = s.next_check = 0;
+    s.budget = kRenjuAiThreatSolverVCTBudget;
+    for (int depth = 2; depth <= kRenjuAiThreatSolverVCTDepth && !win && !s.exhausted(); ++depth) {
+        sequence->clear();
+        win = attack(&s, candidates, player, depth, true, forced, sequence);
+    }
+    ctx->threat_node_count += static_cast<unsigned int>(s.node_count);
+    if (!win) sequence->clear();
+    return win;
+}
+
+bool RenjuAIThreatSolver::attack(State *s, const uint32_t *candidates, int player, int depth, bool threes,
+                                 int forced, std::vector<std::pair<int, int>> *sequence) {
+    if (depth == 0) return false;
+    int opponent = player == 1 ? 2 : 1;
+    int board_size = s->board_size;
+
+    for (int r = 0; r < board_size; ++r) {
+        uint32_t bits = candidates[r];
+
+        // A five of the opponent has to be blocked
+        if (forced >= 0) bits = forced / board_size == r ? 1u << (forced % board_size) : 0;
+
+        for (; bits != 0; bits &= bits - 1) {
+            int c = __builtin_ctz(bits);
+            if (s->exhausted()) return false;
+            if (s->cell(r, c) != 0 || !hasPieces(*s, player, r, c, threes && forced < 0 ? 2 : 3)) continue;
+
+            s->set(r, c, player);
+            ++s->node_count;
+            sequence->push_back(std::make_pair(r, c));
+
+            bool win = false;
+            int fives[2];
+            int five_count = fiveCells(*s, player, r, c, -1, fives);
+            if (five_count >= 2) {
+                // Open four or double four, the opponent has no five to play
+                win = true;
+            } else if (five_count == 1) {
+                // Four, the answer is forced
+                int dr = fives[0] / board_size, dc = fives[0] % board_size;
+                s->set(dr, dc, opponent);
+                ++s->node_count;
+                sequence->push_back(std::make_pair(dr, dc));
+
+                // The answer may make a four, which has to be blocked next
+                int counter_fives[2];
+                int counter_count = fiveCells(*s, opponent, dr, dc, -1, counter_fives);
+                if (counter_count <= 1) {
+                    uint32_t next[kRenjuAiBitboardMaxSize];
+                    memcpy(next, candidates, sizeof(uint32_t) * board_size);
+                    addCandidates(*s, r, c, next);
+                    addCandidates(*s, dr, dc, next);
+                    win = attack(s, next, player, depth - 1, threes,
+                                 counter_count == 1 ? counter_fives[0] : -1, sequence);
+                }
+                if (!win) sequence->pop_back();
+                s->set(dr, dc, 0);
+            } else if (threes && forced < 0 && isThree(s, player, r, c)) {
+                win = defendThree(s, candidates, player, depth, r, c, sequence);
+            }
+
+            s->set(r, c, 0);
+            if (win) return true;
+            sequence->pop_back();
+        }
+    }
+    return false;
+}
+
+bool RenjuAIThreatSolver::defendThree(State *s, const uint32_t *candidates, int player, int depth, int r, int c,
+                                      std::vector<std::pair<int, int>> *sequence) {
+    int opponent = player == 1 ? 2 : 1;
+    int board_size = s->board_size;
+
+    uint32_t next[kRenjuAiBitboardMaxSize];
+    memcpy(next, candidates, sizeof(uint32_t) * board_size);
+    addCandidates(*s, r, c, next);
+
+    // Fours of the opponent first since they fail fast, then cells on the lines of the three
+    std::vector<int> answers;
+    for (int ar = 0; ar < board_size; ++ar) {
+        for (uint32_t bits = next[ar]; bits != 0; bits &= bits - 1) {
+            int ac = __builtin_ctz(bits);
+            if (s->cell(ar, ac) != 0 || !hasPieces(*s, opponent, ar, ac, 3)) continue;
+            int fives[2];
+            s->set(ar, ac, opponent);
+            if (fiveCells(*s, opponent, ar, ac, -1, fives) > 0) answers.push_back(board_size * ar + ac);
+            s->set(ar, ac, 0);
+        }
+    }
+    for (int distance = 1; distance <= 4; ++distance) {
+        for (int o = 0; o < 4; ++o) {
+            for (int side = -1; side <= 1; side += 2) {
+                int ar = r + side * distance * kOrientationDR[o], ac = c + side * distance * kOrientationDC[o];
+                if (ar < 0 || ar >= board_size || ac < 0 || ac >= board_size || s->cell(ar, ac) != 0) continue;
+                int index = board_size * ar + ac;
+                if (std::find(answers.begin(), answers.end(), index) == answers.end()) answers.push_back(index);
+            }
+        }
+    }
+
+    // Every answer has to lose, the sequence follows the first one
+    size_t base = sequence->size();
+    std::vector<std::pair<int, int>> other;
+    for (size_t i = 0; i < answers.size(); ++i) {
+        if (s->exhausted()) {
+            sequence->resize(base);
+            return false;
+        }
+        int ar = answers[i] / board_size, ac = answers[i] % board_size;
+        s->set(ar, ac, opponent);
+        ++s->node_count;
+
+        std::vector<std::pair<int, int>> *line = i == 0 ? sequence : &other;
+        line->push_back(std::make_pair(ar, ac));
+
+        bool win = false;
+        int counter_fives[2];
+        int counter_count = fiveCells(*s, opponent, ar, ac, -1, counter_fives);
+        if (counter_count <= 1) {
+            uint32_t answer_next[kRenjuAiBitboardMaxSize];
+            memcpy(answer_next, next, sizeof(uint32_t) * board_size);
+            addCandidates(*s, ar, ac, answer_next);
+            win = attack(s, answer_next, player, depth - 1, true,
+                         counter_count == 1 ? counter_fives[0] : -1, line);
+        }
+        s->set(ar, ac, 0);
+
+        if (!win) {
+            sequence->resize(base);
+            return false;
+        }
+        other.clear();
+    }
+    return true;
+}
+
+bool RenjuAIThreatSolver::hasPieces(const State &s, int player, int r, int c, int count) {
+    for (int o = 0; o < 4; ++o) {
+        if (__builtin_popcount(s.bits.forward(player, o, r, c) & 0xF) +
+            __builtin_popcount(s.bits.backward(player, o, r, c) & 0xF) >= count) return true;
+    }
+    return false;
+}
+
+int RenjuAIThreatSolver::fiveCells(const State &s, int player, int r, int c, int orientation, int *cells) {
+    int count = 0;
+    for (int o = 0; o < 4; ++o) {
+        if (orientation >= 0 && o != orientation) continue;
+        for (int k = -4; k <= 4; ++k) {
+            int fr = r + k * kOrientationDR[o], fc = c + k * kOrientationDC[o];
+            if (k == 0 || fr < 0 || fr >= s.board_size || fc < 0 || fc >= s.board_size) continue;
+            if (s.cell(fr, fc) != 0 || !makesFive(s, player, fr, fc)) continue;
+            cells[count++] = s.board_size * fr + fc;
+            if (count == 2) return count;
+        }
+    }
+    return count;
+}
+
+bool RenjuAIThreatSolver::isThree(State *s, int player, int r, int c) {
+    // A four with two fives on a line through (r, c)
+    for (int o = 0; o < 4; ++o) {
+        for (int k = -4; k <= 4; ++k) {
+            int fr = r + k * kOrientationDR[o], fc = c + k * kOrientationDC[o];
+            if (k == 0 || fr < 0 || fr >= s->board_size || fc < 0 || fc >= s->board_size) continue;
+            if (s->cell(fr, fc) != 0) continue;
+
+            int fives[2];
+            s->set(fr, fc, player);
+            bool open_four = fiveCells(*s, player, r, c, o, fives) == 2;
+            s->set(fr, fc, 0);
+            if (open_four) return true;
+        }
+    }
+    return false;
+}
+
+void RenjuAIThreatSolver::addCandidates(const State &s, int r, int c, uint32_t *candidates) {
+    uint32_t board_mask = (1u << s.board_size) - 1;
+    uint32_t mask = (c >= 2 ? 0x1Fu << (c - 2) : 0x1Fu >> (2 - c)) & board_mask;
+    for (int cr = std::max(r - 2, 0); cr <= std::min(r + 2, s.board_size - 1); ++cr) candidates[cr] |= mask;
+}
@@ -0,0 +1,80 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/time_manager.h>
+#include <algorithm>
+
+RenjuAITimeManager::RenjuAITimeManager() {}
+
+RenjuAITimeManager::~RenjuAITimeManager() {}
+
+int RenjuAITimeManager::turnTime(int timeout_turn, int time_left, int board_size, int piece_count) {
+    if (timeout_turn == 0) return 0;
+
+    // An equal share of the match time over the moves expected to follow
+    long limit = timeout_turn > 0 ? timeout_turn : -1;
+    if (time_left >= 0) {
+        int moves_to_go = std::max(1, std::min(kRenjuAiTimeMovesToGo, (board_size * board_size - piece_count) / 2));
+        long share = time_left / moves_to_go;
+        limit = limit < 0 ? share : std::min(limit, share);
+    }
+    if (limit < 0) return 0;
+
+    // The move has to be written before the limit
+    limit -= std::min<long>(kRenjuAiTimeOverhead, limit / 10);
+    return static_cast<int>(std::max<long>(limit, 1));
+}
+
+bool RenjuAITimeManager::nextIteration(const std::vector<RenjuAISearchIteration> &iterations, double elapsed_ms,
+                                       int time_limit) {
+    if (time_limit <= 0 || iterations.empty()) return false;
+    const RenjuAISearchIteration &last = iterations.back();
+
+    // A single possible move or an immediate win is found without searching, deeper iterations
+    // neither change a found win
+    if (last.node_count <= 1 || last.score >= kRenjuAiTimeDecidedScore) return false;
+
+    // Iterations before the last that found the same best move
+    int stable = 0;
+    for (auto it = iterations.rbegin() + 1; it != iterations.rend(); ++it) {
+        if (!it->completed || it->pv.empty() || last.pv.empty() || it->pv[0] != last.pv[0]) break;
+        ++stable;
+    }
+    double scale = std::max(kRenjuAiTimeMinimumScale, 1.0 - kRenjuAiTimeStableScale * stable);
+
+    // Iterations are 2 plies apart, a warm table may let an iteration search fewer nodes than the last
+    double factor = std::max(1.0, branchingFactor(iterations));
+    double predicted_ms = last.time_ms * factor * factor;
+    return elapsed_ms + predicted_ms <= time_limit * scale;
+}
+
+bool RenjuAITimeManager::continueDeep(double previous_ms, double elapsed_ms, int time_limit) {
+    if (time_limit <= 0) return true;
+    return elapsed_ms + previous_ms <= time_limit;
+}
+
+double RenjuAITimeManager::branchingFactor(const std::vector<RenjuAISearchIteration> &iterations) {
+    double sum = 0;
+    int count = 0;
+    for (auto it = iterations.rbegin(); it != iterations.rend() && count < 2; ++it) {
+        if (!it->completed || it->branching_factor <= 0) continue;
+        sum += it->branching_factor;
+        ++count;
+    }
+    return count > 0 ? sum / count : kRenjuAiTimeDefaultBranchingFactor;
+}
@@ -0,0 +1,266 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ai/transposition_table.h>
+#include <ai/utils.h>
+#include <algorithm>
+#include <climits>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+// Size of a huge page, tables of at least this size are mapped with huge pages
+#define kRenjuAiTTHugePage (2 << 20)
+
+// Generations are kept in 6 bits of an entry
+#define kRenjuAiTTGenerationMask 0x3F
+
+RenjuAITranspositionTable::RenjuAITranspositionTable(int size_log2) {
+    generation = 0;
+    isolated = false;
+    allocate(size_log2);
+    clear();
+
+    // Generate Zobrist keys
+    RenjuAIUtils::zobristInit(kRenjuAiTTZobristSize, zobrist_1, zobrist_2);
+}
+
+RenjuAITranspositionTable::~RenjuAITranspositionTable() {
+    release();
+}
+
+int RenjuAITranspositionTable::sizeLog2(size_t megabytes) {
+    int size_log2 = 0;
+    while (size_log2 < 40 && memoryBytes(size_log2 + 1) <= (megabytes << 20)) ++size_log2;
+    return std::max(size_log2, 2);
+}
+
+size_t RenjuAITranspositionTable::memoryBytes(int size_log2) {
+    size_t entries = static_cast<size_t>(1) << std::max(size_log2, 0);
+    return std::max(entries / kRenjuAiTTBucketSlots, static_cast<size_t>(1)) * sizeof(Bucket);
+}
+
+bool RenjuAITranspositionTable::probe(uint64_t key, int player, Entry *entry) const {
+    const Bucket &bucket = buckets[key & mask];
+    unsigned int current = generation.load(std::memory_order_relaxed) & kRenjuAiTTGenerationMask;
+    for (const Slot &slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key) continue;
+        if (isolated && entryGeneration(data) != current) continue;
+
+        unpack(data, entry);
+        if (entry->depth == 0 || entry->player != player) continue;
+        entry->key = key;
+        return true;
+    }
+    return false;
+}
+
+void RenjuAITranspositionTable::store(uint64_t key, int player, int depth, int bound, int score,
+                                      int move_r, int move_c) {
+    Bucket &bucket = buckets[key & mask];
+    unsigned int current = generation.load(std::memory_order_relaxed);
+
+    // The entry of the same state, otherwise an empty slot,
+    // then the entry least worth keeping by depth and age
+    Slot *replace = &bucket.slots[0];
+    int replace_value = INT_MAX;
+    for (Slot &slot : bucket.slots) {
+        uint64_t data = slot.data.load(std::memory_order_relaxed);
+        uint64_t check = slot.check.load(std::memory_order_relaxed);
+        Entry e;
+        unpack(data, &e);
+        int age = static_cast<int>((current - entryGeneration(data)) & kRenjuAiTTGenerationMask);
+        if ((check ^ data) == key && e.player == player) {
+            // Keep deeper results of the same state, unless they are hidden from this search
+            if (e.depth > depth && (!isolated || age == 0)) return;
+            replace = &slot;
+            break;
+        }
+
+        int value = e.depth == 0 ? INT_MIN : e.depth - kRenjuAiTTAgeWeight * age;
+        if (value < replace_value) {
+            replace = &slot;
+            replace_value = value;
+        }
+    }
+
+    uint64_t data = pack(score, depth, bound, player, move_r, move_c, current);
+    replace->check.store(key ^ data, std::memory_order_relaxed);
+    replace->data.store(data, std::memory_order_relaxed);
+}
+
+bool RenjuAITranspositionTable::probe(const RenjuAIUtils::SymmetricHash &hash, int player, Entry *entry) const {
+    int symmetry;
+    if (!probe(hash.canonical(&symmetry), player, entry)) return false;
+    if (entry->move_r >= 0 && entry->move_c >= 0) {
+        int r, c;
+        RenjuAIUtils::inverseSymmetricCell(hash.board_size, symmetry, entry->move_r, entry->move_c, &r, &c);
+        entry->move_r = static_cast<char>(r);
+        entry->move_c = static_cast<char>(c);
+    }
+    return true;
+}
+
+void RenjuAITranspositionTable::store(const RenjuAIUtils::SymmetricHash &hash, int player, int depth, int bound,
+                                      int score, int move_r, int move_c) {
+    int symmetry;
+    uint64_t key = hash.canonical(&symmetry);
+    if (move_r >= 0 && move_c >= 0)
+        RenjuAIUtils::symmetricCell(hash.board_size, symmetry, move_r, move_c, &move_r, &move_c);
+    store(key, player, depth, bound, score, move_r, move_c);
+}
+
+void RenjuAITranspositionTable::clear() {
+    // depth == 0 marks an empty entry.
+    // Each thread writes a contiguous part first, its pages are placed on the NUMA node the thread runs on.
+    size_t count = mask + 1;
+    size_t threads = std::min(static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency())),
+                              std::max(bytes / kRenjuAiTTClearChunk, static_cast<size_t>(1)));
+    auto clearRange = [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            for (Slot &slot : buckets[i].slots) {
+                slot.check.store(0, std::memory_order_relaxed);
+                slot.data.store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t)
+        workers.emplace_back(clearRange, count * t / threads, count * (t + 1) / threads);
+    clearRange(0, count / threads);
+    for (auto &worker : workers) worker.join();
+}
+
+void RenjuAITranspositionTable::resize(int size_log2) {
+    release();
+    allocate(size_log2);
+    clear();
+}
+
+void RenjuAITranspositionTable::newSearch() {
+    unsigned int next = generation.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // Entries 64 searches old would look current
+    if (isolated && (next & kRenjuAiTTGenerationMask) == 0) clear();
+}
+
+void RenjuAITranspositionTable::isolateSearches(bool isolate) {
+    isolated = isolate;
+}
+
+size_t RenjuAITranspositionTable::memoryBytes() const {
+    return bytes;
+}
+
+bool RenjuAITranspositionTable::hugePages() const {
+    return huge_pages;
+}
+
+double RenjuAITranspositionTable::usage() const {
+    // Sampled from the first buckets, keys spread entries evenly
+    size_t sample = std::min(static_cast<size_t>(kRenjuAiTTUsageSample), static_cast<size_t>(mask + 1));
+    unsigned int current = generation.load(std::memory_order_relaxed) & kRenjuAiTTGenerationMask;
+    size_t used = 0;
+    for (size_t i = 0; i < sample; ++i) {
+        for (const Slot &slot : buckets[i].slots) {
+            uint64_t data = slot.data.load(std::memory_order_relaxed);
+            Entry e;
+            unpack(data, &e);
+            if (e.depth != 0 && entryGeneration(data) == current) ++used;
+        }
+    }
+    return used / static_cast<double>(sample * kRenjuAiTTBucketSlots);
+}
+
+void RenjuAITranspositionTable::allocate(int size_log2) {
+    // Buckets are used as mapped, cleared by clear()
+    static_assert(std::is_trivially_default_constructible<Bucket>::value, "Buckets need no construction");
+    bytes = memoryBytes(size_log2);
+    mask = bytes / sizeof(Bucket) - 1;
+    huge_pages = false;
+
+#ifdef _WIN32
+    buckets = static_cast<Bucket *>(_aligned_malloc(bytes, kRenjuAiTTCacheLine));
+    if (buckets == nullptr) throw std::bad_alloc();
+#else
+    // Reserved huge pages if the system has enough set aside, transparent huge pages are requested otherwise
+    void *memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (bytes >= kRenjuAiTTHugePage) {
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        huge_pages = memory != MAP_FAILED;
+    }
+#endif
+    if (memory == MAP_FAILED) {
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+        if (bytes >= kRenjuAiTTHugePage) huge_pages = madvise(memory, bytes, MADV_HUGEPAGE) == 0;
+#endif
+    }
+    buckets = static_cast<Bucket *>(memory);
+#endif
+}
+
+void RenjuAITranspositionTable::release() {
+#ifdef _WIN32
+    _aligned_free(buckets);
+#else
+    munmap(buckets, bytes);
+#endif
+    buckets = nullptr;
+}
+
+// Layout: score (32 bits) | depth (8) | bound (2) | player (2) | move_r (5) | move_c (5) | generation (6)
+// A move of (-1, -1) is stored as (31, 31)
+uint64_t RenjuAITranspositionTable::pack(int score, int depth, int bound, int player, int move_r, int move_c,
+                                         unsigned int generation) {
+    uint64_t data = static_cast<uint32_t>(score);
+    data |= static_cast<uint64_t>(depth & 0xFF) << 32;
+    data |= static_cast<uint64_t>(bound & 0x3) << 40;
+    data |= static_cast<uint64_t>(player & 0x3) << 42;
+    data |= static_cast<uint64_t>(move_r & 0x1F) << 44;
+    data |= static_cast<uint64_t>(move_c & 0x1F) << 49;
+    data |= static_cast<uint64_t>(generation & kRenjuAiTTGenerationMask) << 54;
+    return data;
+}
+
+void RenjuAITranspositionTable::unpack(uint64_t data, Entry *entry) {
+    entry->score = static_cast<int>(static_cast<uint32_t>(data));
+    entry->depth = static_cast<char>((data >> 32) & 0xFF);
+    entry->bound = static_cast<char>((data >> 40) & 0x3);
+    entry->player = static_cast<char>((data >> 42) & 0x3);
+    entry->move_r = static_cast<char>((data >> 44) & 0x1F);
+    entry->move_c = static_cast<char>((data >> 49) & 0x1F);
+    if (entry->move_r == 0x1F) entry->move_r = -1;
+    if (entry->move_c == 0x1F) entry->move_c = -1;
+}
+
+unsigned int RenjuAITranspositionTable::entryGeneration(uint64_t data) {
+    return static_cast<unsigned int>((data >> 54) & kRenjuAiTTGenerationMask);
+}
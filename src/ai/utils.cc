@@ -17,20 +17,40 @@
  */
 
 #include <ai/utils.h>
+#include <ai/phase_profiler.h>
 #include <random>
 
-bool RenjuAIUtils::remoteCell(const char *gs, int r, int c) {
+bool RenjuAIUtils::remoteCell(const char *gs, int board_size, int r, int c) {
+    RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseRemoteCell);
     if (gs == nullptr) return false;
     for (int i = r - 2; i <= r + 2; ++i) {
-        if (i < 0 || i >= g_board_size) continue;
+        if (i < 0 || i >= board_size) continue;
         for (int j = c - 2; j <= c + 2; ++j) {
-            if (j < 0 || j >= g_board_size) continue;
-            if (gs[g_board_size * i + j] > 0) return false;
+            if (j < 0 || j >= board_size) continue;
+            if (gs[board_size * i + j] > 0) return false;
         }
     }
     return true;
 }
 
+bool RenjuAIUtils::completesFive(const char *gs, int board_size, int r, int c, int player) {
+    if (gs == nullptr || r < 0 || r >= board_size || c < 0 || c >= board_size) return false;
+    static const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+    for (const auto &d : directions) {
+        int count = 1;
+        for (int side = -1; side <= 1; side += 2) {
+            int i = r + side * d[0], j = c + side * d[1];
+            while (i >= 0 && i < board_size && j >= 0 && j < board_size && gs[board_size * i + j] == player) {
+                ++count;
+                i += side * d[0];
+                j += side * d[1];
+            }
+        }
+        if (count >= 5) return true;
+    }
+    return false;
+}
+
 void RenjuAIUtils::zobristInit(int size, uint64_t *z1, uint64_t *z2) {
     std::random_device rd;
     std::mt19937 gen(rd());
@@ -43,6 +63,15 @@ void RenjuAIUtils::zobristInit(int size, uint64_t *z1, uint64_t *z2) {
     }
 }
 
+void RenjuAIUtils::zobristInit(int size, uint64_t *z1, uint64_t *z2, uint64_t seed) {
+    // The output of mt19937_64 is fully specified, unlike distributions
+    std::mt19937_64 gen(seed);
+    for (int i = 0; i < size; i++) {
+        z1[i] = gen();
+        z2[i] = gen();
+    }
+}
+
 uint64_t RenjuAIUtils::zobristHash(const char *gs, int size, uint64_t *z1, uint64_t *z2) {
     uint64_t state = 0;
     for (int i = 0; i < size; i++) {
@@ -54,3 +83,40 @@ uint64_t RenjuAIUtils::zobristHash(const char *gs, int size, uint64_t *z1, uint6
     }
     return state;
 }
+
+void RenjuAIUtils::zobristHash(const char *gs, int board_size, const uint64_t *z1, const uint64_t *z2,
+                               SymmetricHash *hash) {
+    hash->board_size = board_size;
+    for (int s = 0; s < kRenjuAiUtilsSymmetries; ++s) hash->keys[s] = 0;
+    for (int r = 0; r < board_size; ++r) {
+        for (int c = 0; c < board_size; ++c) {
+            char cell = gs[board_size * r + c];
+            if (cell == 1 || cell == 2) zobristToggle(hash, z1, z2, r, c, cell);
+        }
+    }
+}
+
+void RenjuAIUtils::symmetricState(const char *gs, int board_size, int symmetry, char *result) {
+    for (int r = 0; r < board_size; ++r) {
+        for (int c = 0; c < board_size; ++c) {
+            int sr, sc;
+            symmetricCell(board_size, symmetry, r, c, &sr, &sc);
+            result[board_size * sr + sc] = gs[board_size * r + c];
+        }
+    }
+}
+
+void RenjuAIUtils::packState(const char *gs, int board_size, uint8_t *packed) {
+    int gs_size = board_size * board_size;
+    for (int i = 0; i < packedSize(board_size); ++i) packed[i] = 0;
+    for (int i = 0; i < gs_size; ++i) packed[i >> 2] |= static_cast<uint8_t>((gs[i] & 0x3) << (6 - 2 * (i & 3)));
+}
+
+bool RenjuAIUtils::unpackState(const uint8_t *packed, int board_size, char *gs) {
+    int gs_size = board_size * board_size;
+    for (int i = 0; i < gs_size; ++i) {
+        gs[i] = static_cast<char>((packed[i >> 2] >> (6 - 2 * (i & 3))) & 0x3);
+        if (gs[i] == 3) return false;
+    }
+    return true;
+}
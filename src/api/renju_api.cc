@@ -18,51 +18,373 @@
 
 #include <api/renju_api.h>
 #include <ai/ai_controller.h>
+#include <ai/opening_book.h>
+#include <ai/profile.h>
+#include <ai/result_cache.h>
+#include <ai/search_context.h>
+#include <ai/transposition_table.h>
 #include <ai/utils.h>
-#include <utils/globals.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
-bool RenjuAPI::generateMove(const char *gs_string, int ai_player_id,
+// Profile of searches, replaced as a whole by setProfile
+static std::mutex profile_mutex;
+static std::shared_ptr<const RenjuAIProfile> active_profile = std::make_shared<const RenjuAIProfile>();
+static int profile_serial = 0;
+
+// Memory of tables allocated by searches in megabytes (0: default size)
+static std::atomic<size_t> table_size(0);
+
+bool RenjuAPI::generateMove(const char *gs_string, int board_size, int ai_player_id,
                             int search_depth, int time_limit, int num_threads,
                             int *actual_depth, int *move_r, int *move_c, int *winning_player,
                             unsigned int *node_count, unsigned int *eval_count, unsigned int *pm_count) {
+    return generateMove(nullptr, gs_string, board_size, ai_player_id, search_depth, time_limit, num_threads,
+                        actual_depth, move_r, move_c, winning_player, node_count, eval_count, pm_count);
+}
+
+bool RenjuAPI::generateMove(RenjuAITranspositionTable *tt, const char *gs_string, int board_size, int ai_player_id,
+                            int search_depth, int time_limit, int num_threads,
+                            int *actual_depth, int *move_r, int *move_c, int *winning_player,
+                            unsigned int *node_count, unsigned int *eval_count, unsigned int *pm_count,
+                            std::vector<RenjuAISearchIteration> *iterations,
+                            const std::atomic<bool> *stop,
+                            RenjuAISearchSession *session,
+                            const ProgressCallback &progress,
+                            RenjuAIPhaseProfiler::Counters *phases) {
     // Check input data
-    if (strlen(gs_string) != g_gs_size ||
-        ai_player_id  < 1 || ai_player_id > 2 ||
-        search_depth == 0 || search_depth > 10 ||
-        time_limit < 0    ||
-        num_threads  < 1) {
-        return false;
-    }
+    if (!validInput(gs_string, board_size, ai_player_id, search_depth, time_limit, num_threads)) return false;
 
-    // Copy game state
-    char *gs = new char[g_gs_size];
-    std::memcpy(gs, gs_string, g_gs_size);
+    // Search context of this call
+    RenjuAISearchContext ctx(board_size);
+    ctx.tt = tt;
+    ctx.stop = stop;
+    ctx.session = session;
+    ctx.tt_size_log2 = tableSizeLog2();
+    applyProfile(&ctx);
+
+    // Iterations report the best move as the first move of their principal variation
+    auto t_start = std::chrono::steady_clock::now();
+    if (progress) {
+        ctx.on_iteration = [&ctx, &progress, t_start](const RenjuAISearchIteration &it) {
+            Progress p;
+            p.depth = it.depth;
+            if (!it.pv.empty()) { p.move_r = it.pv[0].first; p.move_c = it.pv[0].second; }
+            p.score = it.score;
+            p.node_count = ctx.node_count;
+            p.time_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t_start).count();
+            progress(p);
+        };
+    }
 
     // Convert from string
-    gsFromString(gs_string, gs);
+    std::vector<char> gs(ctx.gs_size);
+    if (!gsFromString(gs_string, board_size, gs.data())) return false;
 
     // Generate move
-    RenjuAIController::generateMove(gs, ai_player_id, search_depth, time_limit, actual_depth,
-                                    move_r, move_c, winning_player, node_count, eval_count, pm_count);
+    RenjuAIController::generateMove(&ctx, gs.data(), ai_player_id, search_depth, time_limit, num_threads,
+                                    actual_depth, move_r, move_c, winning_player, node_count, eval_count, pm_count);
+    if (iterations != nullptr) *iterations = ctx.iterations;
+    if (phases != nullptr) *phases = ctx.phases;
+    return true;
+}
+
+std::future<RenjuAPI::MoveResult> RenjuAPI::generateMoveAsync(const std::string &gs_string, int board_size,
+                                                              int ai_player_id, int search_depth, int time_limit,
+                                                              int num_threads, const ProgressCallback &progress,
+                                                              const CancellationToken &cancel,
+                                                              RenjuAITranspositionTable *tt,
+                                                              RenjuAISearchSession *session) {
+    // Arguments are copied, the token keeps its flag alive until the search ends
+    return std::async(std::launch::async, [=]() {
+        MoveResult result;
+        result.success = generateMove(tt, gs_string.c_str(), board_size, ai_player_id, search_depth, time_limit,
+                                      num_threads, &result.actual_depth, &result.move_r, &result.move_c,
+                                      &result.winning_player, &result.node_count, &result.eval_count,
+                                      &result.pm_count, nullptr, cancel.flag(), session, progress);
+        result.cancelled = cancel.cancelled();
+        return result;
+    });
+}
+
+bool RenjuAPI::generateMoveCached(RenjuAIResultCache *cache, RenjuAITranspositionTable *tt, const char *gs_string,
+                                  int board_size, int ai_player_id, int search_depth, int time_limit,
+                                  int num_threads, int *actual_depth, int *move_r, int *move_c,
+                                  int *winning_player, unsigned int *node_count, unsigned int *eval_count,
+                                  unsigned int *pm_count, bool *cache_hit,
+                                  std::vector<RenjuAISearchIteration> *iterations,
+                                  const std::atomic<bool> *stop, const ProgressCallback &progress,
+                                  RenjuAIPhaseProfiler::Counters *phases) {
+    if (cache_hit != nullptr) *cache_hit = false;
+    if (iterations != nullptr) iterations->clear();
+    if (phases != nullptr) phases->clear();
+    if (cache == nullptr) {
+        return generateMove(tt, gs_string, board_size, ai_player_id, search_depth, time_limit, num_threads,
+                            actual_depth, move_r, move_c, winning_player, node_count, eval_count, pm_count,
+                            iterations, stop, nullptr, progress, phases);
+    }
+    if (!validInput(gs_string, board_size, ai_player_id, search_depth, time_limit, num_threads)) return false;
+
+    std::vector<char> gs(static_cast<size_t>(board_size * board_size));
+    if (!gsFromString(gs_string, board_size, gs.data())) return false;
+    RenjuAIResultCache::Params params = {ai_player_id, search_depth, time_limit, num_threads, 0};
+    RenjuAIResultCache::Result result = {-1, -1, 0, 0, 0, 0, 0};
+
+    params.profile = applyProfile(nullptr);
+    bool hit = cache->lookup(gs.data(), board_size, params, &result);
+    if (!hit) {
+        generateMove(tt, gs_string, board_size, ai_player_id, search_depth, time_limit, num_threads,
+                     &result.actual_depth, &result.move_r, &result.move_c, &result.winning_player,
+                     &result.node_count, &result.eval_count, &result.pm_count, iterations, stop, nullptr,
+                     progress, phases);
+
+        // A stopped search has not searched as asked
+        if (stop == nullptr || !stop->load()) cache->store(gs.data(), board_size, params, result);
+    }
+
+    if (cache_hit != nullptr) *cache_hit = hit;
+    if (actual_depth != nullptr) *actual_depth = result.actual_depth;
+    if (move_r != nullptr) *move_r = result.move_r;
+    if (move_c != nullptr) *move_c = result.move_c;
+    if (winning_player != nullptr) *winning_player = result.winning_player;
+    if (node_count != nullptr) *node_count = result.node_count;
+    if (eval_count != nullptr) *eval_count = result.eval_count;
+    if (pm_count != nullptr) *pm_count = result.pm_count;
+    return true;
+}
+
+bool RenjuAPI::bookMove(const RenjuAIOpeningBook *book, const char *gs_string, int board_size, int ai_player_id,
+                        int *move_r, int *move_c) {
+    if (book == nullptr || !book->isOpen() || !validInput(gs_string, board_size, ai_player_id, -1, 0, 1))
+        return false;
+
+    std::vector<char> gs(static_cast<size_t>(board_size * board_size));
+    if (!gsFromString(gs_string, board_size, gs.data())) return false;
+    return book->lookup(gs.data(), board_size, ai_player_id, move_r, move_c);
+}
+
+void RenjuAPI::generateMoves(int board_size, int search_depth, int time_limit, int num_workers,
+                             const std::function<bool(BatchItem *)> &next,
+                             const std::function<void(const BatchItem &)> &done) {
+    if (num_workers < 1) num_workers = 1;
+
+    // Input is read under input_mutex, results are reordered and written under output_mutex
+    std::mutex input_mutex, output_mutex;
+    std::condition_variable output_cv;
+    bool end_of_input = false;
+    size_t next_index = 0, next_output = 0;
+    std::map<size_t, BatchItem> finished;
+    const size_t window = static_cast<size_t>(kRenjuAPIBatchWindow * num_workers);
+
+    // Tables of all workers share the memory set by setTableSize
+    size_t total_megabytes = table_size;
+    size_t megabytes = total_megabytes / static_cast<size_t>(num_workers);
+    int tt_size_log2 = total_megabytes > 0 ? RenjuAITranspositionTable::sizeLog2(std::max(megabytes, static_cast<size_t>(1)))
+                                      : tableSizeLog2();
+
+    auto work = [&]() {
+        RenjuAISearchContext ctx(board_size);
+
+        // Positions are unrelated, results should not depend on the order they are searched in
+        RenjuAITranspositionTable tt(tt_size_log2);
+        tt.isolateSearches(true);
+        ctx.tt = &tt;
+        std::vector<char> gs(ctx.gs_size);
+
+        while (true) {
+            // Do not read too far ahead of a slow position
+            {
+                std::unique_lock<std::mutex> lock(output_mutex);
+                output_cv.wait(lock, [&]() { return next_index - next_output < window; });
+            }
+
+            BatchItem item;
+            size_t index;
+            {
+                std::lock_guard<std::mutex> lock(input_mutex);
+                if (end_of_input) break;
+                if (!next(&item)) {
+                    end_of_input = true;
+                    break;
+                }
+                std::lock_guard<std::mutex> output_lock(output_mutex);
+                index = next_index++;
+            }
+
+            searchBatchItem(&ctx, gs.data(), search_depth, time_limit, &item);
+
+            // Write all results that are next in order
+            std::lock_guard<std::mutex> lock(output_mutex);
+            finished.emplace(index, std::move(item));
+            for (auto it = finished.find(next_output); it != finished.end(); it = finished.find(next_output)) {
+                done(it->second);
+                finished.erase(it);
+                ++next_output;
+            }
+            output_cv.notify_all();
+        }
+    };
 
-    // Release memory
-    delete[] gs;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < num_workers - 1; ++i) workers.emplace_back(work);
+    work();
+    for (auto &worker : workers) worker.join();
+}
+
+void RenjuAPI::generateMoves(std::vector<BatchItem> *items, int board_size, int search_depth, int time_limit,
+                             int num_workers) {
+    size_t input = 0, output = 0;
+    generateMoves(board_size, search_depth, time_limit, num_workers,
+                  [&](BatchItem *item) {
+                      if (input >= items->size()) return false;
+                      *item = (*items)[input++];
+                      return true;
+                  },
+                  [&](const BatchItem &item) { (*items)[output++] = item; });
+}
+
+void RenjuAPI::searchBatchItem(RenjuAISearchContext *ctx, char *gs, int search_depth, int time_limit,
+                               BatchItem *item) {
+    item->success = validInput(item->gs_string.c_str(), ctx->board_size, item->ai_player_id,
+                               search_depth, time_limit, 1) &&
+                    gsFromString(item->gs_string.c_str(), ctx->board_size, gs);
+    if (!item->success) return;
+
+    applyProfile(ctx);
+    RenjuAIController::generateMove(ctx, gs, item->ai_player_id, search_depth, time_limit, 1,
+                                    &item->actual_depth, &item->move_r, &item->move_c, &item->winning_player,
+                                    &item->node_count, &item->eval_count, &item->pm_count);
+    item->phases = ctx->phases;
+}
+
+bool RenjuAPI::setProfile(const RenjuAIProfile &profile, std::string *error) {
+    std::string message;
+    if (!profile.validate(&message)) {
+        if (error != nullptr) *error = message;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    active_profile = std::make_shared<const RenjuAIProfile>(profile);
+    ++profile_serial;
     return true;
 }
 
-void RenjuAPI::gsFromString(const char *gs_string, char *gs) {
-    if (strlen(gs_string) != g_gs_size) return;
-    for (int i = 0; i < static_cast<int>(g_gs_size); i++) {
+RenjuAIProfile RenjuAPI::profile() {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    return *active_profile;
+}
+
+void RenjuAPI::setTableSize(size_t megabytes) {
+    table_size = megabytes;
+}
+
+size_t RenjuAPI::tableSize() {
+    return table_size;
+}
+
+int RenjuAPI::tableSizeLog2() {
+    size_t megabytes = table_size;
+    return megabytes > 0 ? RenjuAITranspositionTable::sizeLog2(megabytes) : kRenjuAiTTDefaultSizeLog2;
+}
+
+int RenjuAPI::applyProfile(RenjuAISearchContext *ctx) {
+    std::shared_ptr<const RenjuAIProfile> profile;
+    int serial;
+    {
+        std::lock_guard<std::mutex> lock(profile_mutex);
+        profile = active_profile;
+        serial = profile_serial;
+    }
+    if (ctx != nullptr) profile->apply(ctx);
+    return serial;
+}
+
+bool RenjuAPI::validInput(const char *gs_string, int board_size, int ai_player_id,
+                          int search_depth, int time_limit, int num_threads) {
+    return gs_string != nullptr && board_size >= 1 && board_size <= 20 &&
+           ai_player_id >= 1 && ai_player_id <= 2 &&
+           search_depth != 0 && search_depth <= 10 &&
+           time_limit >= 0 &&
+           num_threads >= 1;
+}
+
+const char RenjuAPI::kPackedDigits[65] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+bool RenjuAPI::gsFromString(const char *gs_string, int board_size, char *gs) {
+    int gs_size = board_size * board_size;
+    size_t length = strlen(gs_string);
+    size_t prefix_length = strlen(kRenjuAPIPackedPrefix);
+
+    if (strncmp(gs_string, kRenjuAPIPackedPrefix, prefix_length) == 0) {
+        // 3 cells per digit, written into gs directly
+        const char *digits = gs_string + prefix_length;
+        if (length - prefix_length != static_cast<size_t>((gs_size + 2) / 3)) return false;
+        for (int i = 0; i < gs_size; i += 3) {
+            int value = packedDigitValue(digits[i / 3]);
+            if (value < 0) return false;
+            for (int k = 0; k < 3; ++k) {
+                int cell = (value >> (4 - 2 * k)) & 0x3;
+                if (i + k < gs_size) gs[i + k] = static_cast<char>(cell);
+                if (cell == 3 || (i + k >= gs_size && cell != 0)) return false;
+            }
+        }
+        return true;
+    }
+
+    if (strncmp(gs_string, kRenjuAPIMovesPrefix, strlen(kRenjuAPIMovesPrefix)) == 0) {
+        // Players alternate from black, a cell is played at most once
+        const char *moves = gs_string + strlen(kRenjuAPIMovesPrefix);
+        size_t moves_length = length - strlen(kRenjuAPIMovesPrefix);
+        if (moves_length % 2 != 0 || moves_length / 2 > static_cast<size_t>(gs_size)) return false;
+        memset(gs, 0, static_cast<size_t>(gs_size));
+        for (size_t i = 0; i < moves_length; i += 2) {
+            int c = moves[i] - 'a', r = moves[i + 1] - 'a';
+            if (RenjuAIUtils::getCell(gs, board_size, r, c) != 0) return false;
+            RenjuAIUtils::setCell(gs, board_size, r, c, static_cast<char>(i % 4 == 0 ? 1 : 2));
+        }
+        return true;
+    }
+
+    if (length != static_cast<size_t>(gs_size)) return false;
+    for (int i = 0; i < gs_size; i++) {
+        if (gs_string[i] < '0' || gs_string[i] > '2') return false;
         gs[i] = gs_string[i] - '0';
     }
+    return true;
+}
+
+std::string RenjuAPI::gsToPacked(const char *gs, int board_size) {
+    int gs_size = board_size * board_size;
+    std::string result = kRenjuAPIPackedPrefix;
+    for (int i = 0; i < gs_size; i += 3) {
+        int value = 0;
+        for (int k = 0; k < 3; ++k) value = (value << 2) | (i + k < gs_size ? gs[i + k] & 0x3 : 0);
+        result.push_back(kPackedDigits[value]);
+    }
+    return result;
+}
+
+int RenjuAPI::packedDigitValue(char digit) {
+    if (digit >= 'A' && digit <= 'Z') return digit - 'A';
+    if (digit >= 'a' && digit <= 'z') return digit - 'a' + 26;
+    if (digit >= '0' && digit <= '9') return digit - '0' + 52;
+    if (digit == '-') return 62;
+    if (digit == '_') return 63;
+    return -1;
 }
 
-std::string RenjuAPI::renderGameState(const char *gs) {
+std::string RenjuAPI::renderGameState(const char *gs, int board_size) {
     std::string result = "";
-    for (int r = 0; r < g_board_size; r++) {
-        for (int c = 0; c < g_board_size; c++) {
-            result.push_back(RenjuAIUtils::getCell(gs, r, c) + '0');
+    for (int r = 0; r < board_size; r++) {
+        for (int c = 0; c < board_size; c++) {
+            result.push_back(RenjuAIUtils::getCell(gs, board_size, r, c) + '0');
             result.push_back(' ');
         }
         result.push_back('\n');
@@ -16,8 +16,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <protocols/batch.h>
+#include <protocols/book.h>
 #include <protocols/cli.h>
 #include <protocols/gomocup.h>
+#include <protocols/server.h>
+#include <ai/phase_profiler.h>
+#include <cstdlib>
 #include <cstring>
 
 // Exclude main() if building with tests
@@ -26,10 +31,23 @@
 int main(int argc, char const *argv[]) {
     if (argc <= 0) return 1;
 
+    // Results break down the cycles of search phases if BLUPIG_PHASES is set (and not "0")
+    const char *phases = getenv("BLUPIG_PHASES");
+    if (phases != nullptr && strcmp(phases, "0") != 0) RenjuAIPhaseProfiler::setEnabled(true);
+
     // Select Gomocup protocol if "pbrain' found in file name
+    // Select server protocol if started as "gomoku serve"
+    // Select batch protocol if started as "gomoku batch"
+    // Select book generation if started as "gomoku book"
     bool success;
     if (strstr(argv[0], "pbrain") != nullptr) {
         success = RenjuProtocolGomocup::beginSession(argc, argv);
+    } else if (argc >= 2 && strcmp(argv[1], "serve") == 0) {
+        success = RenjuProtocolServer::beginSession(argc, argv);
+    } else if (argc >= 2 && strcmp(argv[1], "batch") == 0) {
+        success = RenjuProtocolBatch::beginSession(argc, argv);
+    } else if (argc >= 2 && strcmp(argv[1], "book") == 0) {
+        success = RenjuProtocolBook::beginSession(argc, argv);
     } else {
         success = RenjuProtocolCLI::beginSession(argc, argv);
     }
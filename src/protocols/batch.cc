@@ -0,0 +1,87 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <protocols/batch.h>
+#include <protocols/cli.h>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+// Game states are always on a 19 x 19 board, as in the CLI protocol
+#define kBatchBoardSize 19
+
+bool RenjuProtocolBatch::beginSession(int argc, char const *argv[]) {
+    // Same defaults as the CLI protocol, -t is the number of positions searched at the same time
+    int search_depth = -1;
+    int time_limit = 5500;
+    int num_workers = 1;
+
+    for (int i = 2; i < argc - 1; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "-d", 2) == 0) {
+            RenjuProtocolCLI::parseIntegerArgument(argv[i + 1], 3, &search_depth);
+        } else if (strncmp(arg, "-l", 2) == 0) {
+            RenjuProtocolCLI::parseIntegerArgument(argv[i + 1], 8, &time_limit);
+        } else if (strncmp(arg, "-t", 2) == 0) {
+            RenjuProtocolCLI::parseIntegerArgument(argv[i + 1], 3, &num_workers);
+        } else if (strncmp(arg, "-m", 2) == 0) {
+            RenjuProtocolCLI::selectTableSize(argv[i + 1]);
+        } else if (strncmp(arg, "-c", 2) == 0 && !RenjuProtocolCLI::selectProfile(argv[i + 1])) {
+            std::cout << RenjuProtocolCLI::generateResultJson(nullptr, "Invalid profile.") << std::endl;
+            return false;
+        }
+    }
+
+    // Malformed lines are passed on as invalid items so that every line gets a response
+    RenjuAPI::generateMoves(kBatchBoardSize, search_depth, time_limit, num_workers,
+                            [](RenjuAPI::BatchItem *item) {
+                                std::string line;
+                                if (!std::getline(std::cin, line)) return false;
+                                if (!parseLine(line, item)) item->gs_string.clear();
+                                return true;
+                            },
+                            [](const RenjuAPI::BatchItem &item) {
+                                std::cout << generateResultJson(item) << std::endl;
+                            });
+    return true;
+}
+
+bool RenjuProtocolBatch::parseLine(const std::string &line, RenjuAPI::BatchItem *item) {
+    std::istringstream stream(line);
+    if (!(stream >> item->gs_string)) return false;
+
+    std::string player;
+    if (!(stream >> player)) return true;
+    return RenjuProtocolCLI::parseIntegerArgument(player.c_str(), 1, &item->ai_player_id);
+}
+
+std::string RenjuProtocolBatch::generateResultJson(const RenjuAPI::BatchItem &item) {
+    if (!item.success) return RenjuProtocolCLI::generateResultJson(nullptr, "Invalid input data.");
+
+    std::unordered_map<std::string, std::string> data = {{"move_r", std::to_string(item.move_r)},
+                                                         {"move_c", std::to_string(item.move_c)},
+                                                         {"winning_player", std::to_string(item.winning_player)},
+                                                         {"ai_player", std::to_string(item.ai_player_id)},
+                                                         {"search_depth", std::to_string(item.actual_depth)},
+                                                         {"node_count", std::to_string(item.node_count)},
+                                                         {"eval_count", std::to_string(item.eval_count)},
+                                                         {"pm_count", std::to_string(item.pm_count)}};
+    RenjuProtocolCLI::addProfile(&data);
+    if (RenjuAIPhaseProfiler::enabled()) data["phases"] = RenjuAIPhaseProfiler::toString(item.phases);
+    return RenjuProtocolCLI::generateResultJson(&data, "ok");
+}
@@ -0,0 +1,145 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <protocols/book.h>
+#include <protocols/cli.h>
+#include <api/renju_api.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+bool RenjuProtocolBook::beginSession(int argc, char const *argv[]) {
+    const char *output_path = nullptr;
+    int board_size = 15;
+    int max_stones = 4;
+    int search_depth = 8;
+    int num_workers = 1;
+
+    for (int i = 2; i < argc - 1; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "-o", 2) == 0) {
+            output_path = argv[i + 1];
+        } else if (strncmp(arg, "-b", 2) == 0) {
+            RenjuProtocolCLI::parseIntegerArgument(argv[i + 1], 2, &board_size);
+        } else if (strncmp(arg, "-n", 2) == 0) {
+            RenjuProtocolCLI::parseIntegerArgument(argv[i + 1], 3, &max_stones);
+        } else if (strncmp(arg, "-d", 2) == 0) {
+            RenjuProtocolCLI::parseIntegerArgument(argv[i + 1], 3, &search_depth);
+        } else if (strncmp(arg, "-t", 2) == 0) {
+            RenjuProtocolCLI::parseIntegerArgument(argv[i + 1], 3, &num_workers);
+        }
+    }
+
+    if (output_path == nullptr || board_size < 5 || board_size > 20 || max_stones < 0 ||
+        search_depth < 1 || search_depth > 10) {
+        std::cerr << "Usage: renju book -o <file> [-b <board_size>] [-n <stones>] [-d <depth>] [-t <workers>]"
+                  << std::endl;
+        return false;
+    }
+
+    std::vector<RenjuAIOpeningBook::Entry> entries = generate(board_size, max_stones, search_depth, num_workers);
+    if (!RenjuAIOpeningBook::write(output_path, entries)) {
+        std::cout << RenjuProtocolCLI::generateResultJson(nullptr, "Unable to write book.") << std::endl;
+        return false;
+    }
+
+    std::unordered_map<std::string, std::string> data = {{"entries", std::to_string(entries.size())},
+                                                         {"board_size", std::to_string(board_size)},
+                                                         {"search_depth", std::to_string(search_depth)}};
+    std::cout << RenjuProtocolCLI::generateResultJson(&data, "ok") << std::endl;
+    return true;
+}
+
+std::vector<RenjuAIOpeningBook::Entry> RenjuProtocolBook::generate(int board_size, int max_stones, int search_depth,
+                                                                   int num_workers) {
+    std::vector<RenjuAIOpeningBook::Entry> entries;
+    std::unordered_set<uint64_t> seen;
+    std::vector<char> gs(static_cast<size_t>(board_size * board_size));
+    if (max_stones < 1) return entries;
+
+    // Black opens in the center
+    std::string state(gs.size(), '0');
+    int center = board_size / 2;
+    RenjuAPI::gsFromString(state.c_str(), board_size, gs.data());
+    entries.push_back(RenjuAIOpeningBook::makeEntry(gs.data(), board_size, 1, center, center, 0));
+    state[board_size * center + center] = '1';
+
+    // States with the book player to move, and states after a book move
+    std::vector<std::string> to_move = {state}, played = {state};
+    RenjuAPI::gsFromString(state.c_str(), board_size, gs.data());
+    seen.insert(RenjuAIOpeningBook::key(gs.data(), board_size, 2, nullptr));
+
+    while (!to_move.empty()) {
+        // Search a level of states
+        std::vector<RenjuAPI::BatchItem> items(to_move.size());
+        for (size_t i = 0; i < to_move.size(); ++i) {
+            items[i].gs_string = to_move[i];
+            items[i].ai_player_id = playerToMove(to_move[i]);
+        }
+        RenjuAPI::generateMoves(&items, board_size, search_depth, 0, num_workers);
+
+        for (const auto &item : items) {
+            if (!item.success || item.move_r < 0 || item.winning_player != 0) continue;
+            RenjuAPI::gsFromString(item.gs_string.c_str(), board_size, gs.data());
+            entries.push_back(RenjuAIOpeningBook::makeEntry(gs.data(), board_size, item.ai_player_id,
+                                                            item.move_r, item.move_c, item.actual_depth));
+            std::string next = item.gs_string;
+            next[board_size * item.move_r + item.move_c] = static_cast<char>('0' + item.ai_player_id);
+            played.push_back(next);
+        }
+
+        // Opponent replies lead to the next level
+        to_move.clear();
+        for (const auto &p : played) expand(p, board_size, max_stones, &seen, &to_move);
+        played.clear();
+    }
+    return entries;
+}
+
+void RenjuProtocolBook::expand(const std::string &state, int board_size, int max_stones,
+                               std::unordered_set<uint64_t> *seen, std::vector<std::string> *states) {
+    int stones = static_cast<int>(state.size() - std::count(state.begin(), state.end(), '0'));
+    if (stones + 1 > max_stones) return;
+
+    int player = playerToMove(state);
+    std::vector<char> gs(state.size());
+    for (int r = 0; r < board_size; ++r) {
+        for (int c = 0; c < board_size; ++c) {
+            if (state[board_size * r + c] != '0') continue;
+
+            // Only replies next to a stone
+            bool adjacent = false;
+            for (int i = std::max(r - 1, 0); i <= std::min(r + 1, board_size - 1) && !adjacent; ++i)
+                for (int j = std::max(c - 1, 0); j <= std::min(c + 1, board_size - 1) && !adjacent; ++j)
+                    adjacent = state[board_size * i + j] != '0';
+            if (!adjacent) continue;
+
+            std::string next = state;
+            next[board_size * r + c] = static_cast<char>('0' + player);
+            RenjuAPI::gsFromString(next.c_str(), board_size, gs.data());
+            if (!seen->insert(RenjuAIOpeningBook::key(gs.data(), board_size, 3 - player, nullptr)).second) continue;
+            states->push_back(next);
+        }
+    }
+}
+
+int RenjuProtocolBook::playerToMove(const std::string &state) {
+    // Black moves first
+    int stones = static_cast<int>(state.size() - std::count(state.begin(), state.end(), '0'));
+    return stones % 2 == 0 ? 1 : 2;
+}
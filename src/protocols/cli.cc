@@ -18,32 +18,51 @@
 
 #include <protocols/cli.h>
 #include <api/renju_api.h>
+#include <ai/opening_book.h>
+#include <ai/profile.h>
+#include <ai/search_context.h>
+#include <ai/transposition_table.h>
 #include <utils/json.h>
-#include <utils/globals.h>
 #include <ctime>
 #include <cstdlib>
 #include <cstring>
 
+// Game states are always on a 19 x 19 board
+#define kCLIBoardSize 19
+
+// Longest game state accepted, a list of moves filling the board
+#define kCLIMaxStateLength (2 + 2 * kCLIBoardSize * kCLIBoardSize)
+
 bool RenjuProtocolCLI::beginSession(int argc, char const *argv[]) {
     // Print usage if no arguments provided
     if (argc < 2) {
         std::cerr << "Usage: renju" << std::endl;
-        std::cerr << "        -s <state>       The game state (required)" << std::endl;
+        std::cerr << "        -s <state>       The game state (required): 361 digits, packed ('p:...')" << std::endl;
+        std::cerr << "                         or moves from black on ('m:jjkj...', column and row letters)" << std::endl;
         std::cerr << "       [-p <ai_player>]  AI player (1: black, 2: white; default: 1)" << std::endl;
         std::cerr << "       [-d <depth>]      AI Search depth (iterative deepening)" << std::endl;
         std::cerr << "       [-l <time_limit>] Execution time limit for iterative deepening (5000)" << std::endl;
         std::cerr << "       [-t <threads>]    Number of threads (1)" << std::endl;
+        std::cerr << "       [-b <book>]       Opening book consulted before searching" << std::endl;
+        std::cerr << "       [-c <profile>]    Search profile: default, fast, tournament or a file" << std::endl;
+        std::cerr << "       [-m <megabytes>]  Transposition table memory (4, rounded to a power of 2)" << std::endl;
+        std::cerr << "   or: renju serve [-c <profile>] [-m <megabytes>]" << std::endl;
+        std::cerr << "                         Serve JSON requests, one per line on stdin" << std::endl;
+        std::cerr << "   or: renju batch [-d <depth>] [-l <time_limit>] [-t <workers>] [-c <profile>] [-m <megabytes>]"
+                  << std::endl;
+        std::cerr << "                         Analyse '<state> [<ai_player>]' lines from stdin, in order" << std::endl;
+        std::cerr << "   or: renju book -o <file> [-b <board_size>] [-n <stones>] [-d <depth>] [-t <workers>]" << std::endl;
+        std::cerr << "                         Generate an opening book" << std::endl;
         return false;
     }
 
     // Initialize arguments
-    g_board_size = 19;
-    g_gs_size = (unsigned int)g_board_size * g_board_size;
-    char gs_string[362] = {0};
+    std::string gs_string;
     int ai_player = 1;
     int num_threads = 1;
     int search_depth = -1;
     int time_limit = 5500;
+    RenjuAIOpeningBook book;
 
     // Iterate through arguments
     for (int i = 0; i < argc; i++) {
@@ -53,9 +72,8 @@ bool RenjuProtocolCLI::beginSession(int argc, char const *argv[]) {
             // Check if value exists
             if (i >= argc - 1) continue;
 
-            // Validate and copy state
-            if (validateString(argv[i + 1], 361) == 361)
-                memcpy(gs_string, argv[i + 1], 361);
+            // Copy state, its format is checked by RenjuAPI
+            if (validateString(argv[i + 1], kCLIMaxStateLength) >= 0) gs_string = argv[i + 1];
 
         } else if (strncmp(arg, "-p", 2) == 0) {
             // AI player ID
@@ -77,20 +95,76 @@ bool RenjuProtocolCLI::beginSession(int argc, char const *argv[]) {
             if (i >= argc - 1) continue;
             parseIntegerArgument(argv[i + 1], 3, &num_threads);
 
+        } else if (strncmp(arg, "-b", 2) == 0) {
+            // Opening book, searches if it can not be opened
+            if (i >= argc - 1) continue;
+            book.open(argv[i + 1]);
+
+        } else if (strncmp(arg, "-c", 2) == 0) {
+            // Search profile, checked before searching
+            if (i >= argc - 1) continue;
+            if (!selectProfile(argv[i + 1])) {
+                std::cout << generateResultJson(nullptr, "Invalid profile.") << std::endl;
+                return false;
+            }
+
+        } else if (strncmp(arg, "-m", 2) == 0) {
+            // Transposition table memory
+            if (i >= argc - 1) continue;
+            selectTableSize(argv[i + 1]);
+
         } else if (strncmp(arg, "test", 4) == 0) {
             // Build test data
-            memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000002121000000000000001211112000000000000022122110000000000001211002200000000000002010200000000000000000200000000000000000100000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
+            gs_string = "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000002121000000000000001211112000000000000022122110000000000001211002200000000000002010200000000000000000200000000000000000100000000000000000000000000000000000000000000000000000000000000000000000000000000000";
             search_depth = 8;
             ai_player = 2;
         }
     }
 
-    std::string result = generateMove(gs_string, ai_player, search_depth, time_limit, num_threads);
+    RenjuAITranspositionTable tt(RenjuAPI::tableSizeLog2());
+    std::string result = generateMove(&tt, gs_string.c_str(), ai_player, search_depth, time_limit, num_threads, &book);
     std::cout << result << std::endl;
 
     return true;
 }
 
+bool RenjuProtocolCLI::selectProfile(const char *name_or_path) {
+    RenjuAIProfile profile;
+    std::string error;
+    if (RenjuAIProfile::load(name_or_path, &profile, &error) && RenjuAPI::setProfile(profile, &error)) return true;
+    std::cerr << "Invalid profile: " << error << std::endl;
+    return false;
+}
+
+bool RenjuProtocolCLI::selectTableSize(const char *megabytes) {
+    int value = 0;
+    if (!parseIntegerArgument(megabytes, 6, &value) || value < 1) return false;
+    RenjuAPI::setTableSize(static_cast<size_t>(value));
+    return true;
+}
+
+void RenjuProtocolCLI::addTableStats(const RenjuAITranspositionTable *tt,
+                                     const std::vector<RenjuAISearchIteration> &iterations,
+                                     std::unordered_map<std::string, std::string> *data) {
+    if (tt == nullptr) return;
+    unsigned int tt_probes = 0, tt_hits = 0;
+    for (const auto &it : iterations) {
+        tt_probes += it.tt_probes;
+        tt_hits += it.tt_hits;
+    }
+    (*data)["tt_memory_mb"] = std::to_string(tt->memoryBytes() >> 20);
+    (*data)["tt_huge_pages"] = tt->hugePages() ? "1" : "0";
+    (*data)["tt_hit_rate"] = std::to_string(tt_probes > 0 ? tt_hits / static_cast<double>(tt_probes) : 0);
+    (*data)["tt_usage"] = std::to_string(tt->usage());
+}
+
+void RenjuProtocolCLI::addProfile(std::unordered_map<std::string, std::string> *data) {
+    RenjuAIProfile profile = RenjuAPI::profile();
+    (*data)["profile"] = profile.name;
+    (*data)["breadth"] = RenjuAIProfile::join(profile.breadth);
+    (*data)["pattern_scores"] = RenjuAIProfile::join(profile.pattern_scores);
+}
+
 bool RenjuProtocolCLI::parseIntegerArgument(const char *str, int max_length, int *result) {
     if (validateString(str, max_length) < 0) return false;
     *result = (int)strtol(str, nullptr, 10);
@@ -107,16 +181,28 @@ int RenjuProtocolCLI::validateString(const char *str, int max_length) {
     return -1;
 }
 
-std::string RenjuProtocolCLI::generateMove(const char *gs_string, int ai_player_id, int search_depth,
-                                           int time_limit, int num_threads) {
+std::string RenjuProtocolCLI::generateMove(RenjuAITranspositionTable *tt, const char *gs_string, int ai_player_id,
+                                           int search_depth, int time_limit, int num_threads,
+                                           const RenjuAIOpeningBook *book, RenjuAIResultCache *cache,
+                                           const std::atomic<bool> *stop,
+                                           const RenjuAPI::ProgressCallback &progress) {
     // Record start time
     std::clock_t clock_begin = std::clock();
 
-    // Generate move
-    int move_r, move_c, winning_player, actual_depth;
-    unsigned int node_count, eval_count, pm_count;
-    bool success = RenjuAPI::generateMove(gs_string, ai_player_id, search_depth, time_limit, num_threads, &actual_depth,
-                                          &move_r, &move_c, &winning_player, &node_count, &eval_count, &pm_count);
+    // Use a book move if there is one, book states are openings that nobody wins
+    int move_r, move_c, winning_player = 0, actual_depth = 0;
+    unsigned int node_count = 0, eval_count = 0, pm_count = 0;
+    bool book_move = RenjuAPI::bookMove(book, gs_string, kCLIBoardSize, ai_player_id, &move_r, &move_c);
+
+    // Generate move, unless searched before with the same parameters
+    bool cache_hit = false;
+    std::vector<RenjuAISearchIteration> iterations;
+    RenjuAIPhaseProfiler::Counters phases = {};
+    bool success = book_move ||
+                   RenjuAPI::generateMoveCached(cache, tt, gs_string, kCLIBoardSize, ai_player_id, search_depth,
+                                                time_limit, num_threads, &actual_depth, &move_r, &move_c,
+                                                &winning_player, &node_count, &eval_count, &pm_count, &cache_hit,
+                                                &iterations, stop, progress, &phases);
 
     if (!success) return generateResultJson(nullptr, "Invalid input data.");
 
@@ -139,9 +225,14 @@ std::string RenjuProtocolCLI::generateMove(const char *gs_string, int ai_player_
                                                          {"node_count", std::to_string(node_count)},
                                                          {"eval_count", std::to_string(eval_count)},
                                                          {"pm_count", std::to_string(pm_count)},
-                                                         {"cc_0", std::to_string(g_cc_0)},
-                                                         {"cc_1", std::to_string(g_cc_1)},
+                                                         {"book_move", book_move ? "1" : "0"},
+                                                         {"cache_hit", cache_hit ? "1" : "0"},
+                                                         {"cancelled", !book_move && !cache_hit && stop != nullptr &&
+                                                                       stop->load() ? "1" : "0"},
                                                          {"build", build_datetime}};
+    addProfile(&data);
+    addTableStats(tt, iterations, &data);
+    if (RenjuAIPhaseProfiler::enabled()) data["phases"] = RenjuAIPhaseProfiler::toString(phases);
 
     // Result
     return generateResultJson(&data, "ok");
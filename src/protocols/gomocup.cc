@@ -18,29 +18,82 @@
 
 #include <protocols/gomocup.h>
 #include <api/renju_api.h>
-#include <utils/globals.h>
+#include <ai/opening_book.h>
+#include <ai/profile.h>
+#include <ai/search_session.h>
+#include <ai/time_manager.h>
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
+#include <iomanip>
 #include <iostream>
 
+// Transposition table size (log2 of entries) kept for the session,
+// smaller if half of the memory limit of the manager does not fit it
+#define kGomocupTTSizeLog2 20
+
+// Opening book read from the directory of the executable unless given with "-book <path>"
+#define kGomocupBookFileName "blupig.book"
+
+// Time limit of a turn (ms) until the manager sends one
+#define kGomocupDefaultTimeoutTurn 1500
+
+// Time limit of a ponder search, it normally ends when the opponent moves
+#define kGomocupPonderTimeLimit 86400000
+
 bool RenjuProtocolGomocup::beginSession(int argc, char const *argv[]) {
     char line[256];
     char *gs_string = nullptr;
     bool errored = false;
-    int time_limit = 1500;
+    int timeout_turn = kGomocupDefaultTimeoutTurn;
+    int time_left = -1;
+    int board_size = 0;
+    unsigned int gs_size = 0;
+
+    // Search state kept between turns
+    RenjuAISearchSession session(kGomocupTTSizeLog2);
+    bool ponder_enabled = false;
+    std::string book_path = argv[0];
+    size_t separator = book_path.find_last_of("/\\");
+    book_path = (separator == std::string::npos ? "" : book_path.substr(0, separator + 1)) + kGomocupBookFileName;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-ponder") == 0) ponder_enabled = true;
+        if (strcmp(argv[i], "-book") == 0 && i + 1 < argc) book_path = argv[++i];
+        if (strcmp(argv[i], "-profile") == 0 && i + 1 < argc) {
+            RenjuAIProfile profile;
+            std::string error;
+            if (!RenjuAIProfile::load(argv[++i], &profile, &error) || !RenjuAPI::setProfile(profile, &error)) {
+                std::cerr << "Invalid profile: " << error << std::endl;
+                return false;
+            }
+        }
+    }
+
+    // Moves of known openings are played without searching, a missing book is ignored
+    RenjuAIOpeningBook book;
+    book.open(book_path.c_str());
+    Ponder ponder;
+    SearchResult last_result;
 
     while (std::cin.getline(line, 256)) {
+        auto turn_start = std::chrono::steady_clock::now();
+
+        // Any command other than INFO or TURN invalidates a ponder search
+        if (strncmp(line, "INFO", 4) != 0 && strncmp(line, "TURN", 4) != 0) stopPonder(&ponder);
+
         // Commands
         if (strncmp(line, "START", 5) == 0) {
             // START
-            unsigned int board_size = (unsigned int)atoi(&line[6]);
-            if (board_size >= 15 && board_size <= 20) {
-                g_board_size = board_size;
-                g_gs_size = (unsigned int)g_board_size * g_board_size;
+            int new_board_size = atoi(&line[6]);
+            if (new_board_size >= 15 && new_board_size <= 20) {
+                board_size = new_board_size;
+                gs_size = (unsigned int)board_size * board_size;
 
                 // Initialize game state
-                gs_string = new char[g_gs_size + 1];
-                memset(gs_string, 0, g_gs_size + 1);
-                memset(gs_string, '0', g_gs_size);
+                if (gs_string != nullptr) delete[] gs_string;
+                gs_string = new char[gs_size + 1];
+                memset(gs_string, 0, gs_size + 1);
+                memset(gs_string, '0', gs_size);
 
                 // Write output
                 writeStdout("OK");
@@ -62,11 +115,11 @@ bool RenjuProtocolGomocup::beginSession(int argc, char const *argv[]) {
             }
 
             // Reset board
-            memset(gs_string, '0', g_gs_size);
+            memset(gs_string, '0', gs_size);
 
             // Put a piece in center
-            int move_r = g_board_size / 2, move_c = g_board_size / 2;
-            gs_string[g_board_size * move_r + move_c] = '1';
+            int move_r = board_size / 2, move_c = board_size / 2;
+            gs_string[board_size * move_r + move_c] = '1';
 
             // Write output
             std::cout << move_c << "," << move_r << std::endl;
@@ -81,7 +134,7 @@ bool RenjuProtocolGomocup::beginSession(int argc, char const *argv[]) {
             }
 
             // Reset board
-            memset(gs_string, '0', g_gs_size);
+            memset(gs_string, '0', gs_size);
 
             while (std::cin.getline(line, 256)) {
                 // [X],[Y],[field]
@@ -99,12 +152,15 @@ bool RenjuProtocolGomocup::beginSession(int argc, char const *argv[]) {
                     }
 
                     // Update board
-                    gs_string[g_board_size * values[1] + values[0]] = '0' + static_cast<char>(values[2]);
+                    gs_string[board_size * values[1] + values[0]] = '0' + static_cast<char>(values[2]);
                 }
             }
 
             // Generate, perform a move and write to stdout
-            performAndWriteMove(gs_string, time_limit);
+            int time_limit = turnTime(gs_string, board_size, timeout_turn, time_left);
+            performAndWriteMove(&book, &session, gs_string, board_size, time_limit, &last_result);
+            spendTime(&time_left, turn_start);
+            if (ponder_enabled) startPonder(&ponder, &book, &session, gs_string, board_size, last_result);
 
         } else if (strncmp(line, "TURN", 4) == 0) {
             // TURN [X],[Y]
@@ -121,22 +177,50 @@ bool RenjuProtocolGomocup::beginSession(int argc, char const *argv[]) {
             splitLine(&line[5], values);
             move_c = values[0]; move_r = values[1];
 
-            if (move_r == -1 || move_r >= g_board_size || move_c >= g_board_size) {
+            if (move_r == -1 || move_r >= board_size || move_c >= board_size) {
                 writeStdout("ERROR");
                 errored = true;
                 break;
             }
 
             // Update board
-            gs_string[g_board_size * move_r + move_c] = '2';
+            gs_string[board_size * move_r + move_c] = '2';
 
-            // Generate, perform a move and write to stdout
-            performAndWriteMove(gs_string, time_limit);
+            // Continue pondering if the move was predicted, otherwise search with the warm table
+            int time_limit = turnTime(gs_string, board_size, timeout_turn, time_left);
+            if (ponder.thread.joinable() && ponder.predicted_r == move_r && ponder.predicted_c == move_c) {
+                finishPonder(&ponder, gs_string, board_size, time_limit, turn_start, &last_result);
+            } else {
+                stopPonder(&ponder);
+                performAndWriteMove(&book, &session, gs_string, board_size, time_limit, &last_result);
+            }
+            spendTime(&time_left, turn_start);
+            if (ponder_enabled) startPonder(&ponder, &book, &session, gs_string, board_size, last_result);
 
         } else if (strncmp(line, "INFO", 4) == 0) {
             // INFO [key] [value]
+            // The manager sends time_left before each turn, a match limit is the time left until then
             if (strncmp(line + 5, "timeout_turn", 12) == 0) {
-                time_limit = atoi(line + 5 + 12 + 1) + 500;
+                timeout_turn = atoi(line + 5 + 12 + 1);
+            } else if (strncmp(line + 5, "timeout_match", 13) == 0) {
+                int timeout_match = atoi(line + 5 + 13 + 1);
+                time_left = timeout_match > 0 ? timeout_match : -1;
+            } else if (strncmp(line + 5, "time_left", 9) == 0) {
+                time_left = atoi(line + 5 + 9 + 1);
+            } else if (strncmp(line + 5, "max_memory", 10) == 0) {
+                // Bytes, 0: no limit
+                long long max_memory = strtoll(line + 5 + 10 + 1, nullptr, 10);
+                int size_log2 = kGomocupTTSizeLog2;
+                if (max_memory > 0)
+                    size_log2 = std::min(size_log2, RenjuAITranspositionTable::sizeLog2(
+                                                        static_cast<size_t>(max_memory / 2) >> 20));
+                if (RenjuAITranspositionTable::memoryBytes(size_log2) != session.tt.memoryBytes()) {
+                    stopPonder(&ponder);
+                    session.tt.resize(size_log2);
+                }
+            } else if (strncmp(line + 5, "ponder", 6) == 0) {
+                ponder_enabled = atoi(line + 5 + 6 + 1) != 0;
+                if (!ponder_enabled) stopPonder(&ponder);
             }
         } else if (strncmp(line, "ABOUT", 5) == 0) {
             std::string build_datetime = __DATE__;
@@ -149,33 +233,147 @@ bool RenjuProtocolGomocup::beginSession(int argc, char const *argv[]) {
     }
 
     // Release memory
+    stopPonder(&ponder);
     if (gs_string != nullptr) delete[] gs_string;
 
     return !errored;
 }
 
-void RenjuProtocolGomocup::performAndWriteMove(char *gs_string, int time_limit) {
-    // Generate move
-    int move_r, move_c, winning_player, actual_depth;
-    unsigned int node_count, eval_count;
-    bool success = RenjuAPI::generateMove(gs_string, 1, -1, time_limit, 1, &actual_depth, &move_r, &move_c,
-                                          &winning_player, &node_count, &eval_count, nullptr);
-
-    if (success) {
-        // Write MESSAGE
-        std::cout << "MESSAGE" <<
-                     " d=" << actual_depth <<
-                     " node_cnt=" << node_count <<
-                     " eval_cnt=" << eval_count << std::endl;
-
-        // Update board
-        gs_string[g_board_size * move_r + move_c] = '1';
-
-        // Write output
-        std::cout << move_c << "," << move_r << std::endl;
-    } else {
+void RenjuProtocolGomocup::search(const RenjuAIOpeningBook *book, RenjuAISearchSession *session,
+                                  const char *gs_string, int board_size, int time_limit,
+                                  const std::atomic<bool> *stop, SearchResult *result) {
+    if (RenjuAPI::bookMove(book, gs_string, board_size, 1, &result->move_r, &result->move_c)) {
+        result->success = true;
+        result->book_move = true;
+        return;
+    }
+    result->success = RenjuAPI::generateMove(nullptr, gs_string, board_size, 1, -1, time_limit, 1,
+                                             &result->actual_depth, &result->move_r, &result->move_c,
+                                             &result->winning_player, &result->node_count, &result->eval_count, nullptr,
+                                             &result->iterations, stop, session, nullptr, &result->phases);
+}
+
+void RenjuProtocolGomocup::writeMove(char *gs_string, int board_size, const SearchResult &result) {
+    if (!result.success) {
         writeStdout("ERROR");
+        return;
+    }
+
+    // Write a MESSAGE per iteration, moves are in [X],[Y] order
+    for (const auto &it : result.iterations) {
+        std::cout << "MESSAGE" << std::fixed << std::setprecision(1) <<
+                     " depth=" << it.depth << (it.completed ? "" : " (aborted)") <<
+                     " time=" << it.time_ms << "ms" <<
+                     " nodes=" << it.node_count <<
+                     " cutoffs=" << it.beta_cutoffs <<
+                     " first_cutoff=" << it.firstMoveCutoffRate() * 100 << "%" <<
+                     " re_searches=" << it.re_searches <<
+                     " aspiration_fails=" << it.aspiration_fails <<
+                     " tt_hit=" << it.ttHitRate() * 100 << "%" <<
+                     " tt_usage=" << it.tt_usage * 100 << "%" <<
+                     " ebf=" << std::setprecision(2) << it.branching_factor <<
+                     " score=" << it.score <<
+                     " pv=";
+        for (size_t i = 0; i < it.pv.size(); ++i)
+            std::cout << (i > 0 ? " " : "") << it.pv[i].second << "," << it.pv[i].first;
+        std::cout << std::defaultfloat << std::endl;
     }
+
+    // Write MESSAGE
+    if (result.book_move) std::cout << "MESSAGE book" << std::endl;
+    std::cout << "MESSAGE" <<
+                 " d=" << result.actual_depth <<
+                 " node_cnt=" << result.node_count <<
+                 " eval_cnt=" << result.eval_count << std::endl;
+    if (RenjuAIPhaseProfiler::enabled() && !result.book_move)
+        std::cout << "MESSAGE phases " << RenjuAIPhaseProfiler::toString(result.phases) << std::endl;
+
+    // Update board
+    gs_string[board_size * result.move_r + result.move_c] = '1';
+
+    // Write output
+    std::cout << result.move_c << "," << result.move_r << std::endl;
+}
+
+void RenjuProtocolGomocup::performAndWriteMove(const RenjuAIOpeningBook *book, RenjuAISearchSession *session,
+                                               char *gs_string, int board_size, int time_limit,
+                                               SearchResult *result) {
+    *result = SearchResult();
+    search(book, session, gs_string, board_size, time_limit, nullptr, result);
+    writeMove(gs_string, board_size, *result);
+}
+
+void RenjuProtocolGomocup::startPonder(Ponder *ponder, const RenjuAIOpeningBook *book,
+                                       RenjuAISearchSession *session, const char *gs_string, int board_size,
+                                       const SearchResult &last) {
+    stopPonder(ponder);
+    if (!last.success) return;
+
+    // The opponent reply of the last completed iteration
+    // (the state already includes our move, the first of the variation)
+    int r = -1, c = -1;
+    for (const auto &result_it : last.iterations) {
+        if (!result_it.completed || result_it.pv.size() < 2) continue;
+        r = result_it.pv[1].first; c = result_it.pv[1].second;
+    }
+    if (r < 0 || gs_string[board_size * r + c] != '0') return;
+
+    ponder->predicted_r = r;
+    ponder->predicted_c = c;
+    ponder->gs_string = gs_string;
+    ponder->gs_string[board_size * r + c] = '2';
+    ponder->stop = false;
+    ponder->finished = false;
+    ponder->result = SearchResult();
+    ponder->session = session;
+
+    // The session keeps results of the ponder search only if the prediction was right
+    session->beginSpeculation();
+    ponder->thread = std::thread([ponder, book, session, board_size]() {
+        search(book, session, ponder->gs_string.c_str(), board_size, kGomocupPonderTimeLimit, &ponder->stop,
+               &ponder->result);
+        std::lock_guard<std::mutex> lock(ponder->mutex);
+        ponder->finished = true;
+        ponder->cv.notify_all();
+    });
+}
+
+void RenjuProtocolGomocup::stopPonder(Ponder *ponder) {
+    if (!ponder->thread.joinable()) return;
+    ponder->stop = true;
+    ponder->thread.join();
+    ponder->predicted_r = ponder->predicted_c = -1;
+    ponder->session->endSpeculation(false);
+}
+
+void RenjuProtocolGomocup::finishPonder(Ponder *ponder, char *gs_string, int board_size, int time_limit,
+                                        std::chrono::steady_clock::time_point turn_start, SearchResult *result) {
+    // Search until the time limit of this turn unless it ends before
+    {
+        std::unique_lock<std::mutex> lock(ponder->mutex);
+        ponder->cv.wait_until(lock, turn_start + std::chrono::milliseconds(time_limit),
+                              [ponder]() { return ponder->finished; });
+    }
+    ponder->stop = true;
+    ponder->thread.join();
+    ponder->predicted_r = ponder->predicted_c = -1;
+    ponder->session->endSpeculation(true);
+
+    *result = ponder->result;
+    writeMove(gs_string, board_size, *result);
+}
+
+int RenjuProtocolGomocup::turnTime(const char *gs_string, int board_size, int timeout_turn, int time_left) {
+    int piece_count = static_cast<int>(std::count_if(gs_string, gs_string + board_size * board_size,
+                                                     [](char cell) { return cell != '0'; }));
+    return RenjuAITimeManager::turnTime(timeout_turn, time_left, board_size, piece_count);
+}
+
+void RenjuProtocolGomocup::spendTime(int *time_left, std::chrono::steady_clock::time_point turn_start) {
+    if (*time_left < 0) return;
+    auto spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() -
+                                                                       turn_start).count();
+    *time_left = static_cast<int>(std::max<long>(0, *time_left - spent));
 }
 
 void RenjuProtocolGomocup::splitLine(const char *line, int *output) {
@@ -0,0 +1,202 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <protocols/server.h>
+#include <protocols/cli.h>
+#include <ai/result_cache.h>
+#include <ai/transposition_table.h>
+#include <utils/json.h>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <thread>
+
+// Maximum number of requests searched at the same time
+#define kServerMaxConcurrentRequests 4
+
+// Transposition table size (log2 of entries) kept for the server's lifetime, unless set by -m
+#define kServerTTSizeLog2 20
+
+// Reads an integer given as either a number or a string
+static bool readInteger(const nlohmann::json &request, const char *key, int *result) {
+    auto it = request.find(key);
+    if (it == request.end()) return true;
+    if (it->is_number_integer()) {
+        *result = it->get<int>();
+        return true;
+    }
+    if (it->is_string()) {
+        std::string str = it->get<std::string>();
+        if (str.empty() || str.size() > 8) return false;
+        char *end = nullptr;
+        *result = static_cast<int>(strtol(str.c_str(), &end, 10));
+        return *end == 0;
+    }
+    return false;
+}
+
+bool RenjuProtocolServer::beginSession(int argc, char const *argv[]) {
+    for (int i = 2; i < argc - 1; i++) {
+        if (strncmp(argv[i], "-c", 2) == 0 && !RenjuProtocolCLI::selectProfile(argv[i + 1])) {
+            std::cout << RenjuProtocolCLI::generateResultJson(nullptr, "Invalid profile.") << std::endl;
+            return false;
+        }
+        if (strncmp(argv[i], "-m", 2) == 0) RenjuProtocolCLI::selectTableSize(argv[i + 1]);
+    }
+
+    RenjuAITranspositionTable tt(RenjuAPI::tableSize() > 0 ? RenjuAPI::tableSizeLog2() : kServerTTSizeLog2);
+    RenjuAIResultCache cache;
+    std::mutex mutex;
+    std::condition_variable cv;
+    int active_requests = 0;
+
+    // Requests being searched by id (null: None), cancelled by id or once input ends
+    std::list<std::pair<nlohmann::json, RenjuAPI::CancellationToken>> searches;
+
+    // Responses are written in whole lines
+    auto write = [&mutex](const std::string &response) {
+        std::lock_guard<std::mutex> guard(mutex);
+        std::cout << response << std::endl;
+    };
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) continue;
+
+        // Cancellations are answered at once, even while all slots are taken
+        nlohmann::json request, id;
+        try {
+            request = nlohmann::json::parse(line);
+        } catch (const std::exception &) {}
+        if (request.is_object() && request.find("id") != request.end()) id = request["id"];
+        if (request.is_object() && request.find("cancel") != request.end()) {
+            int cancelled = 0;
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                for (auto &search : searches) {
+                    if (search.first != request["cancel"]) continue;
+                    search.second.cancel();
+                    ++cancelled;
+                }
+            }
+            std::unordered_map<std::string, std::string> data = {{"cancelled", std::to_string(cancelled)}};
+            nlohmann::json response = nlohmann::json::parse(RenjuProtocolCLI::generateResultJson(&data, "ok"));
+            if (!id.is_null()) response["id"] = id;
+            write(response.dump());
+            continue;
+        }
+
+        // Wait for a free slot
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return active_requests < kServerMaxConcurrentRequests; });
+        ++active_requests;
+        auto search = searches.emplace(searches.end(), id, RenjuAPI::CancellationToken());
+        RenjuAPI::CancellationToken cancel = search->second;
+        lock.unlock();
+
+        std::thread([&, search, cancel, line]() {
+            std::string response = handleRequest(&tt, &cache, line, cancel.flag(), write);
+
+            std::lock_guard<std::mutex> guard(mutex);
+            std::cout << response << std::endl;
+            searches.erase(search);
+            --active_requests;
+            cv.notify_all();
+        }).detach();
+    }
+
+    // Nobody reads the remaining responses, searches end with their best move so far
+    std::unique_lock<std::mutex> lock(mutex);
+    for (auto &search : searches) search.second.cancel();
+    cv.wait(lock, [&]() { return active_requests == 0; });
+    return true;
+}
+
+std::string RenjuProtocolServer::handleRequest(RenjuAITranspositionTable *tt, RenjuAIResultCache *cache,
+                                               const std::string &line, const std::atomic<bool> *stop,
+                                               const std::function<void(const std::string &)> &write_progress) {
+    nlohmann::json request;
+    try {
+        request = nlohmann::json::parse(line);
+    } catch (const std::exception &) {
+        return RenjuProtocolCLI::generateResultJson(nullptr, "Invalid request.");
+    }
+    if (!request.is_object()) return RenjuProtocolCLI::generateResultJson(nullptr, "Invalid request.");
+
+    // Same defaults as the CLI protocol
+    std::string gs_string;
+    int ai_player = 1;
+    int search_depth = -1;
+    int time_limit = 5500;
+    int num_threads = 1;
+
+    auto it = request.find("s");
+    if (it != request.end() && it->is_string()) gs_string = it->get<std::string>();
+
+    int progress = 0;
+    bool valid = readInteger(request, "p", &ai_player) &&
+                 readInteger(request, "d", &search_depth) &&
+                 readInteger(request, "l", &time_limit) &&
+                 readInteger(request, "t", &num_threads) &&
+                 readInteger(request, "progress", &progress);
+
+    // Progress lines carry the id of the request
+    RenjuAPI::ProgressCallback progress_callback;
+    if (progress != 0 && write_progress) {
+        nlohmann::json id = request.find("id") != request.end() ? request["id"] : nlohmann::json();
+        progress_callback = [id, &write_progress](const RenjuAPI::Progress &p) {
+            std::unordered_map<std::string, std::string> data = {{"search_depth", std::to_string(p.depth)},
+                                                                 {"move_r", std::to_string(p.move_r)},
+                                                                 {"move_c", std::to_string(p.move_c)},
+                                                                 {"score", std::to_string(p.score)},
+                                                                 {"node_count", std::to_string(p.node_count)},
+                                                                 {"time", std::to_string(
+                                                                     static_cast<int>(p.time_ms))}};
+            nlohmann::json line = nlohmann::json::parse(RenjuProtocolCLI::generateResultJson(&data, "progress"));
+            if (!id.is_null()) line["id"] = id;
+            write_progress(line.dump());
+        };
+    }
+
+    std::string response;
+    if (request.find("stats") != request.end()) {
+        // Cache statistics
+        std::unordered_map<std::string, std::string> data;
+        if (cache != nullptr) {
+            data = {{"cache_size", std::to_string(cache->size())},
+                    {"cache_capacity", std::to_string(cache->capacity())},
+                    {"cache_hits", std::to_string(cache->hits())},
+                    {"cache_misses", std::to_string(cache->misses())}};
+        }
+        response = RenjuProtocolCLI::generateResultJson(&data, "ok");
+    } else if (valid) {
+        response = RenjuProtocolCLI::generateMove(tt, gs_string.c_str(), ai_player, search_depth,
+                                                  time_limit, num_threads, nullptr, cache, stop, progress_callback);
+    } else {
+        response = RenjuProtocolCLI::generateResultJson(nullptr, "Invalid input data.");
+    }
+
+    // Echo request id
+    it = request.find("id");
+    if (it == request.end()) return response;
+    nlohmann::json result = nlohmann::json::parse(response);
+    result["id"] = *it;
+    return result.dump();
+}
@@ -1,27 +0,0 @@
-/*
- * blupig
- * Copyright (C) 2016-2017 Yunzhu Li
- *
- * This program is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation, either version 3 of the License, or
- * any later version.
-
- * This program is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details.
-
- * You should have received a copy of the GNU General Public License
- * along with this program.  If not, see <http://www.gnu.org/licenses/>.
- */
-
-#include <utils/globals.h>
-
-int g_board_size = 19;
-unsigned int g_gs_size = 361;
-unsigned int g_node_count = 0;
-unsigned int g_eval_count = 0;
-unsigned int g_pm_count = 0;
-unsigned int g_cc_0 = 0;
-unsigned int g_cc_1 = 0;
@@ -0,0 +1,99 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <ai/bitboard.h>
+#include <ai/eval.h>
+#include <cstdlib>
+#include <vector>
+
+TEST(RenjuAIBitboardTest, measureDirection) {
+    const int directions[4][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}};
+    srand(11);
+
+    // All supported board sizes
+    for (int board_size = 15; board_size <= kRenjuAiBitboardMaxSize; ++board_size) {
+        RenjuAISearchContext ctx(board_size);
+        for (int round = 0; round < 10; ++round) {
+            // Random game state
+            std::vector<char> gs(ctx.gs_size, 0);
+            for (auto &cell : gs) {
+                int v = rand() % 6;
+                cell = static_cast<char>(v < 2 ? v + 1 : 0);
+            }
+            RenjuAIBitboard bb(board_size, gs.data());
+
+            for (int r = 0; r < board_size; ++r) {
+                for (int c = 0; c < board_size; ++c) {
+                    for (int o = 0; o < 4; ++o) {
+                        for (int p = 1; p <= 2; ++p) {
+                            for (int consecutive = 0; consecutive <= 1; ++consecutive) {
+                                RenjuAIEval::DirectionMeasurement expected, actual;
+                                RenjuAIEval::measureDirection(&ctx, gs.data(), r, c, directions[o][0],
+                                                              directions[o][1], p, consecutive, &expected);
+                                RenjuAIEval::measureDirection(bb, r, c, o, p, consecutive, &actual);
+                                ASSERT_EQ(expected.length, actual.length) << r << "," << c << " o=" << o;
+                                ASSERT_EQ(expected.block_count, actual.block_count) << r << "," << c << " o=" << o;
+                                ASSERT_EQ(expected.space_count, actual.space_count) << r << "," << c << " o=" << o;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST(RenjuAIBitboardTest, winningPlayer) {
+    RenjuAIBitboard bb(20);
+    EXPECT_EQ(0, bb.winningPlayer());
+
+    // Anti-diagonal ending at the corner
+    for (int i = 0; i < 4; ++i) bb.setCell(15 + i, 4 - i, 2);
+    EXPECT_EQ(0, bb.winningPlayer());
+    bb.setCell(19, 0, 2);
+    EXPECT_EQ(2, bb.winningPlayer());
+    bb.setCell(17, 2, 0);
+    EXPECT_EQ(0, bb.winningPlayer());
+
+    // Column on the last line
+    for (int i = 0; i < 5; ++i) bb.setCell(i, 19, 1);
+    EXPECT_EQ(1, bb.winningPlayer());
+}
+
+TEST(RenjuAIBitboardTest, winningPlayerLines) {
+    const int directions[4][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}};
+
+    // A single five on every line of every orientation, for all supported board sizes
+    for (int board_size = 15; board_size <= kRenjuAiBitboardMaxSize; ++board_size) {
+        for (int o = 0; o < 4; ++o) {
+            for (int r = 0; r < board_size; ++r) {
+                for (int c = 0; c < board_size; ++c) {
+                    int er = r + 4 * directions[o][0], ec = c + 4 * directions[o][1];
+                    if (er < 0 || er >= board_size || ec < 0 || ec >= board_size) continue;
+
+                    RenjuAIBitboard bb(board_size);
+                    for (int i = 0; i < 4; ++i) bb.setCell(r + i * directions[o][0], c + i * directions[o][1], 2);
+                    ASSERT_EQ(0, bb.winningPlayer());
+                    bb.setCell(er, ec, 2);
+                    ASSERT_EQ(2, bb.winningPlayer()) << board_size << ": " << r << "," << c << " o=" << o;
+                }
+            }
+        }
+    }
+}
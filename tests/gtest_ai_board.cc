@@ -0,0 +1,71 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <ai/board.h>
+#include <ai/eval.h>
+#include <ai/utils.h>
+#include <cstdlib>
+#include <cstring>
+
+class RenjuAIBoardTest : public ::testing::Test {
+ protected:
+    char gs[361] = {0};
+    RenjuAISearchContext ctx{19};
+
+    // Compares all cached values and candidates against a full evaluation
+    void expectScoresMatch(const RenjuAIBoard &board) {
+        char _gs[361];
+        memcpy(_gs, board.gs(), 361);
+        for (int r = 0; r < 19; ++r)
+            for (int c = 0; c < 19; ++c) {
+                // Candidates are empty cells that are not remote
+                bool candidate = (board.candidates(r) >> c) & 1;
+                ASSERT_EQ(board.cell(r, c) == 0 && !RenjuAIUtils::remoteCell(_gs, 19, r, c), candidate)
+                    << "r=" << r << " c=" << c;
+
+                if (board.cell(r, c) != 0) continue;
+                for (int p = 1; p <= 2; ++p)
+                    ASSERT_EQ(RenjuAIEval::evalMove(&ctx, _gs, r, c, p), board.score(p, r, c))
+                        << "r=" << r << " c=" << c << " p=" << p;
+            }
+    }
+};
+
+TEST_F(RenjuAIBoardTest, makeUnmakeMove) {
+    RenjuAIUtils::setCell(gs, 19, 9, 9, 1);
+    RenjuAIUtils::setCell(gs, 19, 9, 10, 2);
+    RenjuAIBoard board(&ctx, gs);
+    expectScoresMatch(board);
+
+    // Random sequences of moves
+    srand(7);
+    for (int round = 0; round < 20; ++round) {
+        int n = 0;
+        for (int i = 0; i < 12; ++i) {
+            int r = rand() % 19, c = rand() % 19;
+            if (board.cell(r, c) != 0) continue;
+            board.makeMove(&ctx, r, c, (i % 2) + 1);
+            n++;
+            expectScoresMatch(board);
+        }
+        while (n-- > 0) board.unmakeMove();
+        EXPECT_EQ(0, memcmp(gs, board.gs(), 361));
+        expectScoresMatch(board);
+    }
+}
@@ -22,93 +22,112 @@
 
 class RenjuAIEvalTest : public ::testing::Test {
  protected:
+    RenjuAISearchContext ctx{19};
     char gs[361] = {0};
 };
 
 TEST_F(RenjuAIEvalTest, winningPlayer) {
-    EXPECT_EQ(0, RenjuAIEval::winningPlayer(gs));
+    EXPECT_EQ(0, RenjuAIEval::winningPlayer(&ctx, gs));
 
     gs[2] = 1; gs[3] = 1; gs[4] = 1; gs[5] = 1;
-    EXPECT_EQ(0, RenjuAIEval::winningPlayer(gs));
+    EXPECT_EQ(0, RenjuAIEval::winningPlayer(&ctx, gs));
 
     gs[6] = 1;
-    EXPECT_EQ(1, RenjuAIEval::winningPlayer(gs));
+    EXPECT_EQ(1, RenjuAIEval::winningPlayer(&ctx, gs));
 
     gs[7] = 1;
-    EXPECT_EQ(1, RenjuAIEval::winningPlayer(gs));
+    EXPECT_EQ(1, RenjuAIEval::winningPlayer(&ctx, gs));
 
     memset(gs, 0, 361);
 
     gs[2] = 1; gs[3] = 2; gs[4] = 2; gs[5] = 2; gs[6] = 2; gs[7] = 2;
-    EXPECT_EQ(2, RenjuAIEval::winningPlayer(gs));
+    EXPECT_EQ(2, RenjuAIEval::winningPlayer(&ctx, gs));
+}
+
+TEST_F(RenjuAIEvalTest, completesFive) {
+    // Matches the state after the move for lines through the played cell
+    gs[2] = 1; gs[3] = 1; gs[5] = 1;
+    EXPECT_FALSE(RenjuAIUtils::completesFive(gs, 19, 0, 4, 1));
+    gs[6] = 1;
+    EXPECT_TRUE(RenjuAIUtils::completesFive(gs, 19, 0, 4, 1));
+    EXPECT_FALSE(RenjuAIUtils::completesFive(gs, 19, 0, 4, 2));
+
+    // Diagonal ending at the edge, overlines also win
+    for (int i = 15; i < 19; ++i) RenjuAIUtils::setCell(gs, 19, i, 32 - i, 2);
+    EXPECT_TRUE(RenjuAIUtils::completesFive(gs, 19, 14, 18, 2));
+    RenjuAIUtils::setCell(gs, 19, 15, 17, 0);
+    EXPECT_FALSE(RenjuAIUtils::completesFive(gs, 19, 14, 18, 2));
+    gs[7] = 1; gs[8] = 1;
+    EXPECT_TRUE(RenjuAIUtils::completesFive(gs, 19, 0, 4, 1));
+    EXPECT_FALSE(RenjuAIUtils::completesFive(gs, 19, 19, 0, 2));
 }
 
 TEST_F(RenjuAIEvalTest, meausreDirection) {
     RenjuAIEval::DirectionMeasurement dm;
-    RenjuAIEval::measureDirection(gs, 0, 0, 1, 1, 1, true, &dm);
+    RenjuAIEval::measureDirection(&ctx, gs, 0, 0, 1, 1, 1, true, &dm);
     EXPECT_EQ(1, dm.length); EXPECT_EQ(1, dm.block_count); EXPECT_EQ(0, dm.space_count);
 
     // * 0 0
     // 0 1 0
     // 0 0 0
-    RenjuAIUtils::setCell(gs, 1, 1, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 1, 1);
     gs[1 * 15 + 1] = 1;
-    RenjuAIEval::measureDirection(gs, 0, 0, 1, 1, 1, true, &dm);
+    RenjuAIEval::measureDirection(&ctx, gs, 0, 0, 1, 1, 1, true, &dm);
     EXPECT_EQ(2, dm.length); EXPECT_EQ(1, dm.block_count); EXPECT_EQ(0, dm.space_count);
 
     // * 0 0 0
     // 0 1 0 0
     // 0 0 1 0
     // 0 0 0 0
-    RenjuAIUtils::setCell(gs, 2, 2, 1);
-    RenjuAIEval::measureDirection(gs, 0, 0, 1, 1, 1, true, &dm);
+    RenjuAIUtils::setCell(gs, 19, 2, 2, 1);
+    RenjuAIEval::measureDirection(&ctx, gs, 0, 0, 1, 1, 1, true, &dm);
     EXPECT_EQ(3, dm.length); EXPECT_EQ(1, dm.block_count); EXPECT_EQ(0, dm.space_count);
 
     // * 0 0 0
     // 0 1 0 0
     // 0 0 1 0
     // 0 0 0 2
-    RenjuAIUtils::setCell(gs, 3, 3, 2);
-    RenjuAIEval::measureDirection(gs, 0, 0, 1, 1, 1, true, &dm);
+    RenjuAIUtils::setCell(gs, 19, 3, 3, 2);
+    RenjuAIEval::measureDirection(&ctx, gs, 0, 0, 1, 1, 1, true, &dm);
     EXPECT_EQ(3, dm.length); EXPECT_EQ(2, dm.block_count); EXPECT_EQ(0, dm.space_count);
 
     // * 0 0 0
     // 0 1 0 0
     // 0 0 0 0
     // 0 0 0 1
-    RenjuAIUtils::setCell(gs, 2, 2, 0);
-    RenjuAIUtils::setCell(gs, 3, 3, 1);
-    RenjuAIEval::measureDirection(gs, 0, 0, 1, 1, 1, true, &dm);
+    RenjuAIUtils::setCell(gs, 19, 2, 2, 0);
+    RenjuAIUtils::setCell(gs, 19, 3, 3, 1);
+    RenjuAIEval::measureDirection(&ctx, gs, 0, 0, 1, 1, 1, true, &dm);
     EXPECT_EQ(2, dm.length); EXPECT_EQ(1, dm.block_count); EXPECT_EQ(0, dm.space_count);
 
-    RenjuAIEval::measureDirection(gs, 0, 0, 1, 1, 1, false, &dm);
+    RenjuAIEval::measureDirection(&ctx, gs, 0, 0, 1, 1, 1, false, &dm);
     EXPECT_EQ(3, dm.length); EXPECT_EQ(1, dm.block_count); EXPECT_EQ(1, dm.space_count);
 
     // 0 0 0 0 0
     // 0 1 * 1 0
     // 0 0 0 0 0
     memset(gs, 0, 361);
-    RenjuAIUtils::setCell(gs, 1, 1, 1);
-    RenjuAIUtils::setCell(gs, 1, 3, 1);
-    RenjuAIEval::measureDirection(gs, 1, 2, 0, 1, 1, true, &dm);
+    RenjuAIUtils::setCell(gs, 19, 1, 1, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 3, 1);
+    RenjuAIEval::measureDirection(&ctx, gs, 1, 2, 0, 1, 1, true, &dm);
     EXPECT_EQ(3, dm.length); EXPECT_EQ(0, dm.block_count); EXPECT_EQ(0, dm.space_count);
 
-    RenjuAIEval::measureDirection(gs, 1, 2, 0, 1, 1, false, &dm);
+    RenjuAIEval::measureDirection(&ctx, gs, 1, 2, 0, 1, 1, false, &dm);
     EXPECT_EQ(3, dm.length); EXPECT_EQ(0, dm.block_count); EXPECT_EQ(0, dm.space_count);
 
     // 0 0 0 0 0 0
     // 1 1 * 1 0 0
     // 0 0 0 0 0 0
-    RenjuAIUtils::setCell(gs, 1, 0, 1);
-    RenjuAIEval::measureDirection(gs, 1, 2, 0, 1, 1, true, &dm);
+    RenjuAIUtils::setCell(gs, 19, 1, 0, 1);
+    RenjuAIEval::measureDirection(&ctx, gs, 1, 2, 0, 1, 1, true, &dm);
     EXPECT_EQ(4, dm.length); EXPECT_EQ(1, dm.block_count); EXPECT_EQ(0, dm.space_count);
 
     // 0 0 0 0 0 0 0
     // 0 1 * 1 0 1 0
     // 0 0 0 0 0 0 0
-    RenjuAIUtils::setCell(gs, 1, 0, 0);
-    RenjuAIUtils::setCell(gs, 1, 5, 1);
-    RenjuAIEval::measureDirection(gs, 1, 2, 0, 1, 1, false, &dm);
+    RenjuAIUtils::setCell(gs, 19, 1, 0, 0);
+    RenjuAIUtils::setCell(gs, 19, 1, 5, 1);
+    RenjuAIEval::measureDirection(&ctx, gs, 1, 2, 0, 1, 1, false, &dm);
     EXPECT_EQ(4, dm.length); EXPECT_EQ(0, dm.block_count); EXPECT_EQ(1, dm.space_count);
 }
 
@@ -117,7 +136,7 @@ TEST_F(RenjuAIEvalTest, meausreAllDirections) {
 
     // * 0
     // 0 0
-    RenjuAIEval::measureAllDirections(gs, 0, 0, 1, true, adm);
+    RenjuAIEval::measureAllDirections(&ctx, gs, 0, 0, 1, true, adm);
     EXPECT_EQ(1, adm[0].length); EXPECT_EQ(1, adm[1].length); EXPECT_EQ(1, adm[2].length); EXPECT_EQ(1, adm[3].length);
     EXPECT_EQ(1, adm[0].block_count); EXPECT_EQ(1, adm[1].block_count); EXPECT_EQ(1, adm[2].block_count); EXPECT_EQ(2, adm[3].block_count);
     EXPECT_EQ(0, adm[0].space_count); EXPECT_EQ(0, adm[1].space_count); EXPECT_EQ(0, adm[2].space_count); EXPECT_EQ(0, adm[3].space_count);
@@ -125,7 +144,7 @@ TEST_F(RenjuAIEvalTest, meausreAllDirections) {
     // 0 0 0
     // * 0 0
     // 0 0 0
-    RenjuAIEval::measureAllDirections(gs, 1, 0, 1, true, adm);
+    RenjuAIEval::measureAllDirections(&ctx, gs, 1, 0, 1, true, adm);
     EXPECT_EQ(1, adm[0].length); EXPECT_EQ(1, adm[1].length); EXPECT_EQ(1, adm[2].length); EXPECT_EQ(1, adm[3].length);
     EXPECT_EQ(1, adm[0].block_count); EXPECT_EQ(1, adm[1].block_count); EXPECT_EQ(0, adm[2].block_count); EXPECT_EQ(1, adm[3].block_count);
     EXPECT_EQ(0, adm[0].space_count); EXPECT_EQ(0, adm[1].space_count); EXPECT_EQ(0, adm[2].space_count); EXPECT_EQ(0, adm[3].space_count);
@@ -133,8 +152,8 @@ TEST_F(RenjuAIEvalTest, meausreAllDirections) {
     // 0 0 0
     // * 1 0
     // 0 0 0
-    RenjuAIUtils::setCell(gs, 1, 1, 1);
-    RenjuAIEval::measureAllDirections(gs, 1, 0, 1, true, adm);
+    RenjuAIUtils::setCell(gs, 19, 1, 1, 1);
+    RenjuAIEval::measureAllDirections(&ctx, gs, 1, 0, 1, true, adm);
     EXPECT_EQ(2, adm[0].length); EXPECT_EQ(1, adm[1].length); EXPECT_EQ(1, adm[2].length); EXPECT_EQ(1, adm[3].length);
     EXPECT_EQ(1, adm[0].block_count); EXPECT_EQ(1, adm[1].block_count); EXPECT_EQ(0, adm[2].block_count); EXPECT_EQ(1, adm[3].block_count);
     EXPECT_EQ(0, adm[0].space_count); EXPECT_EQ(0, adm[1].space_count); EXPECT_EQ(0, adm[2].space_count); EXPECT_EQ(0, adm[3].space_count);
@@ -145,10 +164,10 @@ TEST_F(RenjuAIEvalTest, meausreAllDirections) {
     // 0 2 0
     // 0 * 0
     // 0 0 0
-    RenjuAIUtils::setCell(gs, 1, 1, 2);
-    RenjuAIUtils::setCell(gs, 2, 1, 2);
-    RenjuAIUtils::setCell(gs, 3, 1, 2);
-    RenjuAIEval::measureAllDirections(gs, 4, 1, 2, true, adm);
+    RenjuAIUtils::setCell(gs, 19, 1, 1, 2);
+    RenjuAIUtils::setCell(gs, 19, 2, 1, 2);
+    RenjuAIUtils::setCell(gs, 19, 3, 1, 2);
+    RenjuAIEval::measureAllDirections(&ctx, gs, 4, 1, 2, true, adm);
     EXPECT_EQ(1, adm[0].length); EXPECT_EQ(1, adm[1].length); EXPECT_EQ(4, adm[2].length); EXPECT_EQ(1, adm[3].length);
     EXPECT_EQ(0, adm[0].block_count); EXPECT_EQ(0, adm[1].block_count); EXPECT_EQ(0, adm[2].block_count); EXPECT_EQ(0, adm[3].block_count);
     EXPECT_EQ(0, adm[0].space_count); EXPECT_EQ(0, adm[1].space_count); EXPECT_EQ(0, adm[2].space_count); EXPECT_EQ(0, adm[3].space_count);
@@ -171,11 +190,11 @@ TEST_F(RenjuAIEvalTest, matchPattern) {
     // 0 * 0
     // 0 0 0
     memset(gs, 0, 361);
-    RenjuAIUtils::setCell(gs, 1, 1, 2);
-    RenjuAIUtils::setCell(gs, 2, 1, 2);
-    RenjuAIUtils::setCell(gs, 3, 1, 2);
-    RenjuAIEval::measureAllDirections(gs, 4, 1, 2, true, adm);
-    EXPECT_EQ(1, RenjuAIEval::matchPattern(adm, &preset_patterns[2]));
+    RenjuAIUtils::setCell(gs, 19, 1, 1, 2);
+    RenjuAIUtils::setCell(gs, 19, 2, 1, 2);
+    RenjuAIUtils::setCell(gs, 19, 3, 1, 2);
+    RenjuAIEval::measureAllDirections(&ctx, gs, 4, 1, 2, true, adm);
+    EXPECT_EQ(1, RenjuAIEval::matchPattern(&ctx, adm, &preset_patterns[2]));
 
     // 0 0 0 0
     // 0 * 2 2
@@ -184,12 +203,12 @@ TEST_F(RenjuAIEvalTest, matchPattern) {
     // 0 2 0 0
     // 0 0 0 0
     memset(gs, 0, 361);
-    RenjuAIUtils::setCell(gs, 1, 2, 2);
-    RenjuAIUtils::setCell(gs, 1, 3, 2);
-    RenjuAIUtils::setCell(gs, 2, 1, 2);
-    RenjuAIUtils::setCell(gs, 4, 1, 2);
-    RenjuAIEval::measureAllDirections(gs, 1, 1, 2, false, adm);
-    EXPECT_EQ(1, RenjuAIEval::matchPattern(adm, &preset_patterns[14]));
+    RenjuAIUtils::setCell(gs, 19, 1, 2, 2);
+    RenjuAIUtils::setCell(gs, 19, 1, 3, 2);
+    RenjuAIUtils::setCell(gs, 19, 2, 1, 2);
+    RenjuAIUtils::setCell(gs, 19, 4, 1, 2);
+    RenjuAIEval::measureAllDirections(&ctx, gs, 1, 1, 2, false, adm);
+    EXPECT_EQ(1, RenjuAIEval::matchPattern(&ctx, adm, &preset_patterns[14]));
 
     // 0 0 0 0 0
     // 0 * 2 2 0
@@ -198,12 +217,12 @@ TEST_F(RenjuAIEvalTest, matchPattern) {
     // 0 0 0 0 0
     // 0 0 0 0 0
     memset(gs, 0, 361);
-    RenjuAIUtils::setCell(gs, 1, 2, 2);
-    RenjuAIUtils::setCell(gs, 1, 3, 2);
-    RenjuAIUtils::setCell(gs, 2, 2, 2);
-    RenjuAIUtils::setCell(gs, 3, 3, 2);
-    RenjuAIEval::measureAllDirections(gs, 1, 1, 2, false, adm);
-    EXPECT_EQ(1, RenjuAIEval::matchPattern(adm, &preset_patterns[14]));
+    RenjuAIUtils::setCell(gs, 19, 1, 2, 2);
+    RenjuAIUtils::setCell(gs, 19, 1, 3, 2);
+    RenjuAIUtils::setCell(gs, 19, 2, 2, 2);
+    RenjuAIUtils::setCell(gs, 19, 3, 3, 2);
+    RenjuAIEval::measureAllDirections(&ctx, gs, 1, 1, 2, false, adm);
+    EXPECT_EQ(1, RenjuAIEval::matchPattern(&ctx, adm, &preset_patterns[14]));
 
     // 0 0 0 0 0 0
     // 0 * 2 0 2 0
@@ -212,14 +231,34 @@ TEST_F(RenjuAIEvalTest, matchPattern) {
     // 0 2 0 0 0 0
     // 0 1 0 0 0 0
     memset(gs, 0, 361);
-    RenjuAIUtils::setCell(gs, 1, 2, 2);
-    RenjuAIUtils::setCell(gs, 1, 4, 2);
-    RenjuAIUtils::setCell(gs, 2, 1, 2);
-    RenjuAIUtils::setCell(gs, 3, 1, 2);
-    RenjuAIUtils::setCell(gs, 4, 1, 2);
-    RenjuAIUtils::setCell(gs, 5, 1, 1);
-    RenjuAIEval::measureAllDirections(gs, 1, 1, 2, false, adm);
-    EXPECT_EQ(1, RenjuAIEval::matchPattern(adm, &preset_patterns[10]));
+    RenjuAIUtils::setCell(gs, 19, 1, 2, 2);
+    RenjuAIUtils::setCell(gs, 19, 1, 4, 2);
+    RenjuAIUtils::setCell(gs, 19, 2, 1, 2);
+    RenjuAIUtils::setCell(gs, 19, 3, 1, 2);
+    RenjuAIUtils::setCell(gs, 19, 4, 1, 2);
+    RenjuAIUtils::setCell(gs, 19, 5, 1, 1);
+    RenjuAIEval::measureAllDirections(&ctx, gs, 1, 1, 2, false, adm);
+    EXPECT_EQ(1, RenjuAIEval::matchPattern(&ctx, adm, &preset_patterns[10]));
+}
+
+TEST_F(RenjuAIEvalTest, evalADM) {
+    const RenjuAIEval::PresetPatterns &preset = RenjuAIEval::presetPatterns();
+    RenjuAIEval::DirectionMeasurement adm[4];
+
+    // Lookup table agrees with pattern matching in every order of directions
+    int codes[4];
+    for (codes[0] = 0; codes[0] < kRenjuAiEvalDMCodes; ++codes[0])
+    for (codes[1] = 0; codes[1] < kRenjuAiEvalDMCodes; ++codes[1])
+    for (codes[2] = 0; codes[2] < kRenjuAiEvalDMCodes; ++codes[2])
+    for (codes[3] = 0; codes[3] < kRenjuAiEvalDMCodes; ++codes[3]) {
+        for (int i = 0; i < 4; ++i) {
+            adm[i].length = static_cast<char>(codes[i] / 6 + 1);
+            adm[i].block_count = static_cast<char>(codes[i] % 6 / 2);
+            adm[i].space_count = static_cast<char>(codes[i] % 2);
+            ASSERT_EQ(codes[i], RenjuAIEval::dmCode(adm[i]));
+        }
+        ASSERT_EQ(RenjuAIEval::matchPresetPatterns(nullptr, preset, adm), RenjuAIEval::evalADM(&ctx, adm));
+    }
 }
 
 TEST_F(RenjuAIEvalTest, evalMove) {
@@ -228,39 +267,39 @@ TEST_F(RenjuAIEvalTest, evalMove) {
     // 0 * 1 1 1 1 2
     // 0 0 0 0 0 0 0
     memset(gs, 0, 361);
-    RenjuAIUtils::setCell(gs, 1, 2, 1);
-    RenjuAIUtils::setCell(gs, 1, 3, 1);
-    RenjuAIUtils::setCell(gs, 1, 4, 1);
-    RenjuAIUtils::setCell(gs, 1, 5, 1);
-    RenjuAIUtils::setCell(gs, 1, 6, 2);
-    EXPECT_EQ(10004, RenjuAIEval::evalMove(gs, 1, 1, 1));
+    RenjuAIUtils::setCell(gs, 19, 1, 2, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 3, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 4, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 5, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 6, 2);
+    EXPECT_EQ(10004, RenjuAIEval::evalMove(&ctx, gs, 1, 1, 1));
 
     // 0 0 0 0 0 0 0 0
     // 0 1 1 * 1 1 1 0
     // 0 0 0 0 0 0 0 0
     memset(gs, 0, 361);
-    RenjuAIUtils::setCell(gs, 1, 1, 1);
-    RenjuAIUtils::setCell(gs, 1, 2, 1);
-    RenjuAIUtils::setCell(gs, 1, 4, 1);
-    RenjuAIUtils::setCell(gs, 1, 5, 1);
-    RenjuAIUtils::setCell(gs, 1, 6, 1);
-    EXPECT_EQ(10004, RenjuAIEval::evalMove(gs, 1, 3, 1));
+    RenjuAIUtils::setCell(gs, 19, 1, 1, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 2, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 4, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 5, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 6, 1);
+    EXPECT_EQ(10004, RenjuAIEval::evalMove(&ctx, gs, 1, 3, 1));
 
     // 0 0 0 0 0 0
     // 0 * 1 1 1 0
     // 0 0 0 0 0 0
     memset(gs, 0, 361);
-    RenjuAIUtils::setCell(gs, 1, 2, 1);
-    RenjuAIUtils::setCell(gs, 1, 3, 1);
-    RenjuAIUtils::setCell(gs, 1, 4, 1);
-    EXPECT_EQ(703, RenjuAIEval::evalMove(gs, 1, 1, 1));
+    RenjuAIUtils::setCell(gs, 19, 1, 2, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 3, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 4, 1);
+    EXPECT_EQ(703, RenjuAIEval::evalMove(&ctx, gs, 1, 1, 1));
 
     // 0 0 0 0 0 0
     // 0 1 * 1 1 0
     // 0 0 0 0 0 0
     memset(gs, 0, 361);
-    RenjuAIUtils::setCell(gs, 1, 1, 1);
-    RenjuAIUtils::setCell(gs, 1, 3, 1);
-    RenjuAIUtils::setCell(gs, 1, 4, 1);
-    EXPECT_EQ(703, RenjuAIEval::evalMove(gs, 1, 2, 1));
+    RenjuAIUtils::setCell(gs, 19, 1, 1, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 3, 1);
+    RenjuAIUtils::setCell(gs, 19, 1, 4, 1);
+    EXPECT_EQ(703, RenjuAIEval::evalMove(&ctx, gs, 1, 2, 1));
 }
@@ -18,10 +18,16 @@
 
 #include <gtest/gtest.h>
 #include <ai/negamax.h>
+#include <ai/search_session.h>
+#include <ai/transposition_table.h>
 #include <api/renju_api.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 class RenjuAINegamaxTest : public ::testing::Test {
  protected:
+    RenjuAISearchContext ctx{19};
     char gs[361] = {0};
     char gs_string[362] = {0};
 };
@@ -31,33 +37,33 @@ TEST_F(RenjuAINegamaxTest, heuristicNegamax0) {
     int move_r0, move_c0, move_r1, move_c1;
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000200100000000000000122200000000000000011200000000000000001210000000000000000200200000000000000110000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000200100000000000000122221000000000000011220000000000000001210000000000000001200200000000000011112000000000000002000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000100000000000000000220000000000002111122000000000000001121200000000000000211020000000000000002021000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000100000000000000000020000000000000100112100000000000001222210000000000000020122000000000000000101200000000000000000002000000000000000000010000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000110000000000000000020000000000000000022200000000000000120200010000000000020102120000000000010121210000000000000100211000000000000000000200000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 1, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 1, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 }
 
@@ -66,38 +72,296 @@ TEST_F(RenjuAINegamaxTest, heuristicNegamax1) {
     int move_r0, move_c0, move_r1, move_c1;
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000100100000000000000121111200000000000002020000000000000000022100000000000000000200000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001211100000000000000111200000000000000021220000000000000002000000000000000000200000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001110000000000000000120000000000000000122200000000000000021112000000000000000000000000000000000002000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 
     memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001010000000000000000120000000000000002122211000000000001021112000000000000020101000000000000010202000000000000000002000000000000000002210000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 
     memcpy(gs_string, "1000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000010000000000000000020000000000000002120000000000000000220000000000000000010200000000000000000001000000000000000000000000010000000000000000000000000000000000000000000000000000000000000000010000000000000000000000000000000000000000000000000000", 362);
-    RenjuAPI::gsFromString(gs_string, gs);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, true,  nullptr, &move_r0, &move_c0);
-    RenjuAINegamax::heuristicNegamax(gs, 2, 4, 0, false, nullptr, &move_r1, &move_c1);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, true,  nullptr, &move_r0, &move_c0);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, false, nullptr, &move_r1, &move_c1);
     EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
 }
+
+TEST_F(RenjuAINegamaxTest, concurrentSearches) {
+
+    int move_r0, move_c0, move_r1, move_c1, move_r2, move_c2;
+
+    memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001010000000000000000120000000000000002122211000000000001021112000000000000020101000000000000010202000000000000000002000000000000000002210000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, true, nullptr, &move_r0, &move_c0);
+
+    // Searches with separate contexts share nothing
+    RenjuAISearchContext ctx1(19), ctx2(19);
+    std::thread t1([&]() { RenjuAINegamax::heuristicNegamax(&ctx1, gs, 2, 4, 0, 1, true, nullptr, &move_r1, &move_c1); });
+    std::thread t2([&]() { RenjuAINegamax::heuristicNegamax(&ctx2, gs, 2, 4, 0, 1, true, nullptr, &move_r2, &move_c2); });
+    t1.join(); t2.join();
+
+    EXPECT_EQ(move_r0, move_r1); EXPECT_EQ(move_c0, move_c1);
+    EXPECT_EQ(move_r0, move_r2); EXPECT_EQ(move_c0, move_c2);
+    EXPECT_EQ(ctx1.node_count, ctx2.node_count);
+}
+
+TEST_F(RenjuAINegamaxTest, deadline) {
+
+    int move_r = -1, move_c = -1, actual_depth = -1;
+
+    memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001211100000000000000111200000000000000021220000000000000002000000000000000000200000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+
+    // Iterations are aborted at the deadline, a move is still produced
+    auto t_start = std::chrono::steady_clock::now();
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, -1, 1, 1, true, &actual_depth, &move_r, &move_c);
+    auto elapsed = std::chrono::steady_clock::now() - t_start;
+
+    EXPECT_TRUE(ctx.aborted);
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 500);
+    EXPECT_EQ(0, actual_depth);
+    ASSERT_GE(move_r, 0); ASSERT_GE(move_c, 0);
+    EXPECT_EQ(0, gs[19 * move_r + move_c]);
+
+    // Also if the root is the node that reads the clock
+    std::atomic<bool> stop(true);
+    ctx.stop = &stop;
+    ctx.node_count = kRenjuAiSearchDeadlineInterval - 1;
+    move_r = move_c = -1;
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, -1, 5000, 1, true, &actual_depth, &move_r, &move_c);
+    EXPECT_TRUE(ctx.aborted);
+    ASSERT_GE(move_r, 0); ASSERT_GE(move_c, 0);
+    EXPECT_EQ(0, gs[19 * move_r + move_c]);
+
+    // Nodes aborted before scoring a move return a neutral score, not INT_MIN
+    ASSERT_GE(ctx.iterations.size(), 1u);
+    EXPECT_FALSE(ctx.iterations.back().completed);
+    EXPECT_EQ(0, ctx.iterations.back().score);
+}
+
+TEST_F(RenjuAINegamaxTest, iterations) {
+
+    int move_r, move_c, actual_depth;
+
+    memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001211100000000000000111200000000000000021220000000000000002000000000000000000200000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+
+    // A fixed-depth search is a single iteration
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, true, nullptr, &move_r, &move_c);
+    ASSERT_EQ(1u, ctx.iterations.size());
+    EXPECT_EQ(4, ctx.iterations[0].depth);
+    EXPECT_TRUE(ctx.iterations[0].completed);
+    EXPECT_EQ(ctx.node_count, ctx.iterations[0].node_count);
+
+    // Iterative deepening records every pass, the principal variation starts with the result
+    ctx.resetCounters();
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, -1, 1000, 1, true, &actual_depth, &move_r, &move_c);
+    ASSERT_GE(ctx.iterations.size(), 1u);
+    unsigned int node_count = 0;
+    for (const auto &it : ctx.iterations) {
+        node_count += it.node_count;
+        EXPECT_LE(it.first_move_cutoffs, it.beta_cutoffs);
+        EXPECT_LE(it.tt_hits, it.tt_probes);
+    }
+    RenjuAISearchIteration last = ctx.iterations[0];
+    for (const auto &it : ctx.iterations)
+        if (it.completed) last = it;
+    ASSERT_GE(last.pv.size(), 1u);
+    EXPECT_EQ(actual_depth, last.depth);
+    EXPECT_EQ(ctx.node_count, node_count);
+    EXPECT_EQ(move_r, last.pv[0].first); EXPECT_EQ(move_c, last.pv[0].second);
+}
+
+TEST_F(RenjuAINegamaxTest, session) {
+
+    int move_r, move_c, actual_depth;
+
+    memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001211100000000000000111200000000000000021220000000000000002000000000000000000200000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+
+    RenjuAISearchSession session;
+    ctx.session = &session;
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 10, 0, 1, true, nullptr, &move_r, &move_c);
+    EXPECT_EQ(10, session.depth);
+    EXPECT_GT(session.time_ms, 0);
+    ASSERT_GE(session.pv.size(), 1u);
+    EXPECT_EQ(move_r, session.pv[0].first); EXPECT_EQ(move_c, session.pv[0].second);
+
+    // Continue with quiet moves far from the pieces so that no forcing win appears
+    session.pv = {{0, 18}, {18, 0}, {1, 17}};
+    session.time_ms = 0;
+
+    // A state that did not follow the principal variation starts from the first depth
+    char other[361];
+    memcpy(other, gs, sizeof(other));
+    other[19 * session.pv[0].first + session.pv[0].second] = 2;
+    EXPECT_TRUE(session.continuation(other, 19, 2).empty());
+
+    // Playing the expected reply continues 2 plies shallower than the previous search
+    auto pv = session.pv;
+    gs[19 * pv[0].first + pv[0].second] = 2;
+    gs[19 * pv[1].first + pv[1].second] = 1;
+
+    // Unless that iteration took longer than the time limit on the previous turn
+    session.beginSpeculation();
+    session.time_ms = 2000;
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, -1, 1000, 1, true, &actual_depth, &move_r, &move_c);
+    ASSERT_GE(ctx.iterations.size(), 1u);
+    EXPECT_EQ(6, ctx.iterations[0].depth);
+    session.endSpeculation(false);
+
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, -1, 1000, 1, true, &actual_depth, &move_r, &move_c);
+    ASSERT_GE(ctx.iterations.size(), 1u);
+    EXPECT_EQ(8, ctx.iterations[0].depth);
+}
+
+TEST_F(RenjuAINegamaxTest, sessionSpeculation) {
+
+    int move_r, move_c;
+
+    memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001211100000000000000111200000000000000021220000000000000002000000000000000000200000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+
+    RenjuAISearchSession session;
+    ctx.session = &session;
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 6, 0, 1, true, nullptr, &move_r, &move_c);
+    auto pv = session.pv;
+    auto history = session.history;
+
+    // A speculative search of a position that was not played leaves the session as it was
+    char other[361];
+    memcpy(other, gs, sizeof(other));
+    other[0] = 2;
+    session.beginSpeculation();
+    RenjuAINegamax::heuristicNegamax(&ctx, other, 1, 4, 0, 1, true, nullptr, &move_r, &move_c);
+    EXPECT_EQ(4, session.depth);
+    session.endSpeculation(false);
+    EXPECT_EQ(6, session.depth);
+    EXPECT_EQ(pv, session.pv);
+    EXPECT_EQ(history, session.history);
+
+    // A kept one replaces it
+    session.beginSpeculation();
+    RenjuAINegamax::heuristicNegamax(&ctx, other, 1, 4, 0, 1, true, nullptr, &move_r, &move_c);
+    session.endSpeculation(true);
+    EXPECT_EQ(4, session.depth);
+}
+
+TEST_F(RenjuAINegamaxTest, killersHistory) {
+
+    ctx.resetKillers(4);
+    ctx.addCutoff(1, 4, 1, 2, 3);
+    ctx.addCutoff(1, 4, 1, 2, 3);
+    ctx.addCutoff(1, 2, 1, 5, 6);
+
+    // The latest move first, a repeated move is kept once
+    EXPECT_EQ(19 * 5 + 6, ctx.killers[kRenjuAiSearchKillerSlots * 1]);
+    EXPECT_EQ(19 * 2 + 3, ctx.killers[kRenjuAiSearchKillerSlots * 1 + 1]);
+    EXPECT_EQ(-1, ctx.killers[0]);
+
+    // History is weighted by the square of the remaining depth, per player
+    EXPECT_EQ(32u, ctx.history[19 * 2 + 3]);
+    EXPECT_EQ(4u, ctx.history[19 * 5 + 6]);
+    EXPECT_EQ(0u, ctx.history[ctx.gs_size + 19 * 2 + 3]);
+}
+
+TEST_F(RenjuAINegamaxTest, specialisedKernels) {
+    // Searches specialised for a board size match the generic search
+    const char *states[] = {
+        "000000000000000000000000000000000000000000000000000000000000000000000000000000001211100000000001112000000000002122000000000002000000000000002000000000000000000000000000000000000000000000000000000000000000000000000000000000000",
+        "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001211100000000000000111200000000000000021220000000000000002000000000000000000200000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000"};
+    for (int i = 0; i < 2; ++i) {
+        int board_size = i == 0 ? 15 : 19;
+        RenjuAISearchContext generic_ctx(board_size), specialised_ctx(board_size);
+        RenjuAPI::gsFromString(states[i], board_size, gs);
+
+        // Tables with the same keys, replacements in colliding slots change node counts otherwise
+        RenjuAITranspositionTable generic_tt, specialised_tt;
+        memcpy(specialised_tt.zobrist_1, generic_tt.zobrist_1, sizeof(generic_tt.zobrist_1));
+        memcpy(specialised_tt.zobrist_2, generic_tt.zobrist_2, sizeof(generic_tt.zobrist_2));
+        generic_ctx.tt = &generic_tt;
+        specialised_ctx.tt = &specialised_tt;
+
+        int r0 = -1, c0 = -1, r1 = -1, c1 = -1;
+        RenjuAINegamax::heuristicNegamax(&generic_ctx, gs, 2, 6, 0, 1, true, nullptr, &r0, &c0);
+        if (board_size == 15)
+            RenjuAINegamax::heuristicNegamax<15>(&specialised_ctx, gs, 2, 6, 0, 1, true, nullptr, &r1, &c1);
+        else
+            RenjuAINegamax::heuristicNegamax<19>(&specialised_ctx, gs, 2, 6, 0, 1, true, nullptr, &r1, &c1);
+
+        EXPECT_EQ(r0, r1); EXPECT_EQ(c0, c1);
+        EXPECT_EQ(generic_ctx.node_count, specialised_ctx.node_count);
+        EXPECT_EQ(generic_ctx.eval_count, specialised_ctx.eval_count);
+    }
+}
+
+TEST_F(RenjuAINegamaxTest, principalVariationSearch) {
+
+    memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000200100000000000000122200000000000000011200000000000000001210000000000000000200200000000000000110000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+
+    // Null-window scouts keep the root score of a full-width search
+    int r0, c0, r1, c1;
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, false, nullptr, &r0, &c0);
+    int score = ctx.iterations[0].score;
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, 4, 0, 1, true, nullptr, &r1, &c1);
+    EXPECT_EQ(r0, r1); EXPECT_EQ(c0, c1);
+    EXPECT_EQ(score, ctx.iterations[0].score);
+    EXPECT_GT(ctx.iterations[0].re_searches, 0u);
+    EXPECT_EQ(0, ctx.iterations[0].aspiration_fails);
+
+    // Iterations after the first are searched within aspiration windows, widened at most once per side
+    RenjuAINegamax::heuristicNegamax(&ctx, gs, 2, -1, 1000, 1, true, nullptr, &r1, &c1);
+    for (const auto &it : ctx.iterations) {
+        EXPECT_LE(it.re_searches, it.node_count);
+        EXPECT_LE(it.aspiration_fails, 2);
+    }
+}
+
+TEST_F(RenjuAINegamaxTest, searchBreadth) {
+
+    memcpy(gs_string, "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000200100000000000000122200000000000000011200000000000000001210000000000000000200200000000000000110000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000", 362);
+    RenjuAPI::gsFromString(gs_string, 19, gs);
+
+    // The presets, given explicitly or not, and a narrower search, all with the same table keys
+    RenjuAITranspositionTable tt[3];
+    RenjuAISearchContext ctx_preset(19), ctx_given(19), ctx_narrow(19);
+    RenjuAISearchContext *contexts[3] = {&ctx_preset, &ctx_given, &ctx_narrow};
+    ctx_given.breadth = {17, 7, 5, 3, 3};
+    ctx_narrow.breadth = {5, 3};
+
+    int r[3], c[3];
+    for (int i = 0; i < 3; ++i) {
+        memcpy(tt[i].zobrist_1, tt[0].zobrist_1, sizeof(tt[0].zobrist_1));
+        memcpy(tt[i].zobrist_2, tt[0].zobrist_2, sizeof(tt[0].zobrist_2));
+        contexts[i]->tt = &tt[i];
+        RenjuAINegamax::heuristicNegamax(contexts[i], gs, 2, 6, 0, 1, true, nullptr, &r[i], &c[i]);
+    }
+    EXPECT_EQ(r[0], r[1]); EXPECT_EQ(c[0], c[1]);
+    EXPECT_EQ(ctx_preset.node_count, ctx_given.node_count);
+    EXPECT_LT(ctx_narrow.node_count, ctx_preset.node_count);
+    ASSERT_GE(r[2], 0); ASSERT_GE(c[2], 0);
+    EXPECT_EQ(0, gs[19 * r[2] + c[2]]);
+}
@@ -0,0 +1,88 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <ai/opening_book.h>
+#include <ai/utils.h>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+
+class RenjuAIOpeningBookTest : public ::testing::Test {
+ protected:
+    char gs[225] = {0};
+    std::string path = ::testing::internal::TempDir() + "blupig_test.book";
+
+    void TearDown() override { std::remove(path.c_str()); }
+};
+
+TEST_F(RenjuAIOpeningBookTest, symmetricLookup) {
+    // Black at (7, 7) and (7, 8), white at (6, 7), black to move at (7, 9)
+    RenjuAIUtils::setCell(gs, 15, 7, 7, 1);
+    RenjuAIUtils::setCell(gs, 15, 7, 8, 1);
+    RenjuAIUtils::setCell(gs, 15, 6, 7, 2);
+    std::vector<RenjuAIOpeningBook::Entry> entries = {RenjuAIOpeningBook::makeEntry(gs, 15, 1, 7, 9, 8)};
+    ASSERT_TRUE(RenjuAIOpeningBook::write(path.c_str(), entries));
+
+    RenjuAIOpeningBook book;
+    ASSERT_TRUE(book.open(path.c_str()));
+    EXPECT_EQ(1u, book.size());
+
+    int r = -1, c = -1;
+    EXPECT_TRUE(book.lookup(gs, 15, 1, &r, &c));
+    EXPECT_EQ(7, r); EXPECT_EQ(9, c);
+
+    // Every symmetry of the state, the move is mapped the same way
+    for (int s = 0; s < kRenjuAiUtilsSymmetries; ++s) {
+        char sgs[225] = {0};
+        for (int i = 0; i < 15; ++i) {
+            for (int j = 0; j < 15; ++j) {
+                int si, sj;
+                RenjuAIUtils::symmetricCell(15, s, i, j, &si, &sj);
+                RenjuAIUtils::setCell(sgs, 15, si, sj, RenjuAIUtils::getCell(gs, 15, i, j));
+            }
+        }
+        int er, ec;
+        RenjuAIUtils::symmetricCell(15, s, 7, 9, &er, &ec);
+        EXPECT_TRUE(book.lookup(sgs, 15, 1, &r, &c));
+        EXPECT_EQ(er, r); EXPECT_EQ(ec, c);
+    }
+
+    // Swapped colours with white to move
+    for (int i = 0; i < 225; ++i)
+        if (gs[i] != 0) gs[i] = static_cast<char>(3 - gs[i]);
+    EXPECT_TRUE(book.lookup(gs, 15, 2, &r, &c));
+    EXPECT_EQ(7, r); EXPECT_EQ(9, c);
+
+    // Other player to move, other board size
+    EXPECT_FALSE(book.lookup(gs, 15, 1, &r, &c));
+    char large[361] = {0};
+    EXPECT_FALSE(book.lookup(large, 19, 1, &r, &c));
+}
+
+TEST_F(RenjuAIOpeningBookTest, invalidFile) {
+    RenjuAIOpeningBook book;
+    EXPECT_FALSE(book.open(path.c_str()));
+    EXPECT_FALSE(book.isOpen());
+
+    std::ofstream(path, std::ios::binary) << "BLUPIGBK but not a book";
+    EXPECT_FALSE(book.open(path.c_str()));
+
+    int r, c;
+    EXPECT_FALSE(book.lookup(gs, 15, 1, &r, &c));
+}
@@ -0,0 +1,72 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <ai/phase_profiler.h>
+#include <api/renju_api.h>
+#include <string>
+
+TEST(RenjuAIPhaseProfilerTest, scope) {
+    // Scopes count nothing unless enabled
+    RenjuAIPhaseProfiler::Counters begin = RenjuAIPhaseProfiler::threadCounters();
+    { RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseSorting); }
+    EXPECT_EQ(0u, RenjuAIPhaseProfiler::threadCounters().since(begin).calls[kRenjuAiPhaseSorting]);
+
+    RenjuAIPhaseProfiler::setEnabled(true);
+    {
+        RenjuAIPhaseProfiler::Scope phase(kRenjuAiPhaseSorting);
+        RenjuAIPhaseProfiler::Scope nested(kRenjuAiPhaseEvalMove);
+    }
+    RenjuAIPhaseProfiler::setEnabled(false);
+    RenjuAIPhaseProfiler::Counters counted = RenjuAIPhaseProfiler::threadCounters().since(begin);
+    EXPECT_EQ(1u, counted.calls[kRenjuAiPhaseSorting]);
+    EXPECT_EQ(1u, counted.calls[kRenjuAiPhaseEvalMove]);
+    EXPECT_GE(counted.cycles[kRenjuAiPhaseSorting], counted.cycles[kRenjuAiPhaseEvalMove]);
+
+    counted.add(counted);
+    EXPECT_EQ(2u, counted.calls[kRenjuAiPhaseSorting]);
+    counted.clear();
+    EXPECT_EQ(0u, counted.calls[kRenjuAiPhaseSorting]);
+    EXPECT_STREQ("eval_move", RenjuAIPhaseProfiler::phaseName(kRenjuAiPhaseEvalMove));
+}
+
+TEST(RenjuAIPhaseProfilerTest, search) {
+    // Phases of all search threads, calls match the search counters
+    RenjuAIPhaseProfiler::setEnabled(true);
+    int actual_depth, move_r, move_c, winning_player;
+    unsigned int eval_count;
+    RenjuAIPhaseProfiler::Counters phases;
+    ASSERT_TRUE(RenjuAPI::generateMove(nullptr, "m:hhihii", 15, 2, 4, 0, 2, &actual_depth, &move_r, &move_c,
+                                       &winning_player, nullptr, &eval_count, nullptr, nullptr, nullptr, nullptr,
+                                       nullptr, &phases));
+    RenjuAIPhaseProfiler::setEnabled(false);
+    // The search is timed once on the calling thread, inner phases of 2 threads fit in twice its time
+    EXPECT_EQ(1u, phases.calls[kRenjuAiPhaseSearch]);
+    EXPECT_EQ(eval_count, phases.calls[kRenjuAiPhaseEvalMove]);
+    EXPECT_GT(phases.calls[kRenjuAiPhaseMoveGeneration], 0u);
+    EXPECT_EQ(phases.calls[kRenjuAiPhaseMoveGeneration], phases.calls[kRenjuAiPhaseSorting]);
+    for (int i = kRenjuAiPhaseSearch + 1; i < kRenjuAiPhaseCount; ++i)
+        EXPECT_LE(phases.cycles[i], 2 * phases.cycles[kRenjuAiPhaseSearch]);
+    EXPECT_EQ(0u, RenjuAIPhaseProfiler::toString(phases).find("cycles="));
+
+    // Nothing is timed while disabled
+    ASSERT_TRUE(RenjuAPI::generateMove(nullptr, "m:hhihii", 15, 2, 4, 0, 2, &actual_depth, &move_r, &move_c,
+                                       &winning_player, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+                                       nullptr, &phases));
+    EXPECT_EQ(0u, phases.calls[kRenjuAiPhaseSearch]);
+}
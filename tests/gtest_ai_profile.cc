@@ -0,0 +1,151 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <ai/eval.h>
+#include <ai/profile.h>
+#include <ai/search_context.h>
+#include <api/renju_api.h>
+#include <string>
+#include <vector>
+
+TEST(RenjuAIProfileTest, builtIn) {
+    RenjuAIProfile profile;
+    std::string error;
+    EXPECT_EQ("default", profile.name);
+    EXPECT_TRUE(profile.validate(&error));
+    EXPECT_EQ(std::vector<int>(RenjuAIEval::presetScores, RenjuAIEval::presetScores + kRenjuAiEvalPatterns),
+              profile.pattern_scores);
+
+    // Built-in profiles are valid
+    for (const char *name : {"default", "fast", "tournament"}) {
+        ASSERT_TRUE(RenjuAIProfile::builtIn(name, &profile));
+        EXPECT_EQ(name, profile.name);
+        EXPECT_TRUE(profile.validate(&error)) << error;
+    }
+    EXPECT_FALSE(RenjuAIProfile::builtIn("casual", &profile));
+}
+
+TEST(RenjuAIProfileTest, parse) {
+    RenjuAIProfile profile;
+    std::string error;
+
+    // Values replace those of the base profile
+    ASSERT_TRUE(RenjuAIProfile::parse("# Tier 2\n\nbase = fast\nname = tier-2\n breadth = 9, 5,3 \r\n",
+                                      &profile, &error)) << error;
+    EXPECT_EQ("tier-2", profile.name);
+    EXPECT_EQ(std::vector<int>({9, 5, 3}), profile.breadth);
+    EXPECT_EQ(kRenjuAiEvalPatterns, static_cast<int>(profile.pattern_scores.size()));
+
+    // Text of a profile is parsed back into the same values
+    RenjuAIProfile copy;
+    profile.pattern_scores[9] = 25;
+    ASSERT_TRUE(RenjuAIProfile::parse(profile.toString(), &copy, &error)) << error;
+    EXPECT_EQ(profile.name, copy.name);
+    EXPECT_EQ(profile.breadth, copy.breadth);
+    EXPECT_EQ(profile.pattern_scores, copy.pattern_scores);
+
+    // Malformed lines, invalid values and unknown keys leave the profile unchanged
+    for (const char *text : {"breadth 9", "breadth = 9,x", "breadth = ", "base = casual", "depth = 8",
+                             "breadth = 0", "patterns = 10000, 700"}) {
+        error.clear();
+        EXPECT_FALSE(RenjuAIProfile::parse(text, &copy, &error)) << text;
+        EXPECT_FALSE(error.empty());
+        EXPECT_EQ(profile.breadth, copy.breadth);
+    }
+
+    // Files are read unless a built-in profile has the name
+    EXPECT_TRUE(RenjuAIProfile::load("tournament", &profile, &error));
+    EXPECT_FALSE(RenjuAIProfile::load("/nonexistent/profile.txt", &profile, &error));
+}
+
+TEST(RenjuAIProfileTest, validate) {
+    RenjuAIProfile profile;
+    std::string error;
+
+    profile.breadth = {};
+    EXPECT_FALSE(profile.validate(&error));
+    profile.breadth = {kRenjuAiProfileMaxBreadth + 1};
+    EXPECT_FALSE(profile.validate(&error));
+    profile.breadth = {kRenjuAiProfileMaxBreadth, 1};
+    EXPECT_TRUE(profile.validate(&error));
+
+    // Scores keep winning, threatening and other patterns apart
+    RenjuAIProfile preset;
+    const int invalid[][2] = {{0, kRenjuAiEvalWinningScore - 1},
+                              {1, kRenjuAiEvalWinningScore},
+                              {kRenjuAiEvalThreateningPatterns - 1, kRenjuAiEvalThreateningScore - 1},
+                              {kRenjuAiEvalThreateningPatterns, kRenjuAiEvalThreateningScore},
+                              {kRenjuAiEvalPatterns - 1, -1}};
+    for (const auto &value : invalid) {
+        profile.pattern_scores = preset.pattern_scores;
+        profile.pattern_scores[value[0]] = value[1];
+        EXPECT_FALSE(profile.validate(&error)) << value[0];
+    }
+    profile.pattern_scores = preset.pattern_scores;
+    profile.pattern_scores.push_back(1);
+    EXPECT_FALSE(profile.validate(&error));
+}
+
+TEST(RenjuAIProfileTest, apply) {
+    RenjuAISearchContext ctx(15);
+    RenjuAIProfile profile;
+    ASSERT_TRUE(RenjuAIProfile::builtIn("fast", &profile));
+
+    // Preset scores share the preset table, other scores get a table of their own once
+    profile.apply(&ctx);
+    EXPECT_EQ(profile.breadth, ctx.breadth);
+    EXPECT_EQ(RenjuAIEval::presetPatterns().adm_scores, ctx.adm_scores);
+
+    profile.pattern_scores[kRenjuAiEvalPatterns - 1] = 0;
+    profile.apply(&ctx);
+    const int *adm_scores = ctx.adm_scores;
+    EXPECT_NE(RenjuAIEval::presetPatterns().adm_scores, adm_scores);
+    EXPECT_EQ(adm_scores, RenjuAIEval::scoreTable(profile.pattern_scores));
+
+    // A lone open two (the last pattern) loses its score, others keep theirs
+    std::vector<char> gs(ctx.gs_size, 0);
+    gs[15 * 7 + 7] = 1;
+    int preset_score = RenjuAIEval::evalMove(&ctx, gs.data(), 7, 8, 1);
+    ctx.adm_scores = nullptr;
+    EXPECT_EQ(preset_score + RenjuAIEval::presetScores[kRenjuAiEvalPatterns - 1],
+              RenjuAIEval::evalMove(&ctx, gs.data(), 7, 8, 1));
+    gs[15 * 7 + 8] = 1;
+    ctx.adm_scores = adm_scores;
+    preset_score = RenjuAIEval::evalMove(&ctx, gs.data(), 7, 9, 1);
+    ctx.adm_scores = nullptr;
+    EXPECT_EQ(preset_score, RenjuAIEval::evalMove(&ctx, gs.data(), 7, 9, 1));
+}
+
+TEST(RenjuAIProfileTest, renjuAPI) {
+    RenjuAIProfile profile;
+    ASSERT_TRUE(RenjuAIProfile::builtIn("fast", &profile));
+
+    // Invalid profiles are refused, the current one is kept
+    RenjuAIProfile invalid = profile;
+    invalid.breadth = {0};
+    std::string error;
+    EXPECT_FALSE(RenjuAPI::setProfile(invalid, &error));
+    EXPECT_FALSE(error.empty());
+    EXPECT_EQ("default", RenjuAPI::profile().name);
+
+    EXPECT_TRUE(RenjuAPI::setProfile(profile));
+    EXPECT_EQ("fast", RenjuAPI::profile().name);
+    EXPECT_EQ(profile.breadth, RenjuAPI::profile().breadth);
+    EXPECT_TRUE(RenjuAPI::setProfile(RenjuAIProfile()));
+}
@@ -0,0 +1,86 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <ai/result_cache.h>
+#include <ai/utils.h>
+
+class RenjuAIResultCacheTest : public ::testing::Test {
+ protected:
+    char gs[225] = {0};
+    RenjuAIResultCache::Params params = {1, -1, 5500, 1, 0};
+    RenjuAIResultCache::Result result = {7, 9, 0, 8, 100, 200, 300};
+};
+
+TEST_F(RenjuAIResultCacheTest, symmetricLookup) {
+    RenjuAIResultCache cache(4);
+    RenjuAIUtils::setCell(gs, 15, 7, 7, 1);
+    RenjuAIUtils::setCell(gs, 15, 6, 9, 2);
+
+    RenjuAIResultCache::Result found;
+    EXPECT_FALSE(cache.lookup(gs, 15, params, &found));
+    cache.store(gs, 15, params, result);
+
+    // Symmetric game states share the result, the move is mapped
+    for (int s = 0; s < kRenjuAiUtilsSymmetries; ++s) {
+        char sgs[225];
+        RenjuAIUtils::symmetricState(gs, 15, s, sgs);
+        int r, c;
+        RenjuAIUtils::symmetricCell(15, s, 7, 9, &r, &c);
+        ASSERT_TRUE(cache.lookup(sgs, 15, params, &found));
+        EXPECT_EQ(r, found.move_r); EXPECT_EQ(c, found.move_c);
+        EXPECT_EQ(8, found.actual_depth); EXPECT_EQ(100u, found.node_count);
+    }
+
+    // Other parameters
+    RenjuAIResultCache::Params other = params;
+    other.player = 2;
+    EXPECT_FALSE(cache.lookup(gs, 15, other, &found));
+    other = params;
+    other.search_depth = 6;
+    EXPECT_FALSE(cache.lookup(gs, 15, other, &found));
+    other = params;
+    other.profile = 1;
+    EXPECT_FALSE(cache.lookup(gs, 15, other, &found));
+
+    EXPECT_EQ(1u, cache.size());
+    EXPECT_EQ(8u, cache.hits());
+    EXPECT_EQ(4u, cache.misses());
+}
+
+TEST_F(RenjuAIResultCacheTest, leastRecentlyUsed) {
+    RenjuAIResultCache cache(2);
+    char states[3][225] = {{0}};
+    for (int i = 0; i < 3; ++i) RenjuAIUtils::setCell(states[i], 15, 7, i, 1);
+
+    RenjuAIResultCache::Result found;
+    cache.store(states[0], 15, params, result);
+    cache.store(states[1], 15, params, result);
+
+    // Using the first state drops the second one
+    EXPECT_TRUE(cache.lookup(states[0], 15, params, &found));
+    cache.store(states[2], 15, params, result);
+    EXPECT_EQ(2u, cache.size());
+    EXPECT_TRUE(cache.lookup(states[0], 15, params, &found));
+    EXPECT_FALSE(cache.lookup(states[1], 15, params, &found));
+    EXPECT_TRUE(cache.lookup(states[2], 15, params, &found));
+
+    cache.clear();
+    EXPECT_EQ(0u, cache.size());
+    EXPECT_FALSE(cache.lookup(states[0], 15, params, &found));
+}
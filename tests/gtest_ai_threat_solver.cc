@@ -0,0 +1,101 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <ai/board.h>
+#include <ai/eval.h>
+#include <ai/threat_solver.h>
+#include <api/renju_api.h>
+#include <vector>
+
+class RenjuAIThreatSolverTest : public ::testing::Test {
+ protected:
+    RenjuAISearchContext ctx{15};
+    std::vector<char> gs = std::vector<char>(225, 0);
+
+    // Number of empty cells where player makes five
+    int fiveCount(int player) {
+        int count = 0;
+        for (auto &cell : gs) {
+            if (cell != 0) continue;
+            cell = static_cast<char>(player);
+            if (RenjuAIEval::winningPlayer(&ctx, gs.data()) == player) ++count;
+            cell = 0;
+        }
+        return count;
+    }
+
+    void set(int r, int c, int player) { gs[15 * r + c] = static_cast<char>(player); }
+};
+
+TEST_F(RenjuAIThreatSolverTest, vcf) {
+    RenjuAPI::gsFromString("000000000000000000000000000000000000000000000000000000000000000000000000000000000000010000000000000220000000021111220000000000112120000000000211020000000000020210000000000000000000000000000000000000000000000000000000000000000", 15, gs.data());
+    RenjuAIBoard board(&ctx, gs.data());
+
+    std::vector<std::pair<int, int>> sequence;
+    ASSERT_TRUE(RenjuAIThreatSolver::solve(&ctx, board, 1, &sequence));
+    ASSERT_EQ(1u, sequence.size() % 2);
+    EXPECT_GT(ctx.threat_node_count, 0u);
+
+    // Every four is answered at its only five, the last move makes two
+    for (size_t i = 0; i < sequence.size(); i += 2) {
+        EXPECT_EQ(0, fiveCount(2));
+        set(sequence[i].first, sequence[i].second, 1);
+        if (i + 1 == sequence.size()) {
+            EXPECT_GE(fiveCount(1), 2);
+            break;
+        }
+        ASSERT_EQ(1, fiveCount(1));
+        set(sequence[i + 1].first, sequence[i + 1].second, 2);
+        EXPECT_EQ(0, RenjuAIEval::winningPlayer(&ctx, gs.data()));
+    }
+}
+
+TEST_F(RenjuAIThreatSolverTest, vct) {
+    // Two pairs that make two threes with one move, no four is possible
+    set(7, 7, 1); set(7, 8, 1); set(8, 9, 1); set(9, 9, 1);
+    set(0, 0, 2); set(0, 2, 2); set(14, 14, 2); set(14, 12, 2);
+    RenjuAIBoard board(&ctx, gs.data());
+
+    std::vector<std::pair<int, int>> sequence;
+    ASSERT_TRUE(RenjuAIThreatSolver::solve(&ctx, board, 1, &sequence));
+    ASSERT_GE(sequence.size(), 1u);
+    set(sequence[0].first, sequence[0].second, 1);
+    EXPECT_EQ(0, fiveCount(1));
+
+    // The opponent has no forcing win
+    gs[15 * sequence[0].first + sequence[0].second] = 0;
+    EXPECT_FALSE(RenjuAIThreatSolver::solve(&ctx, board, 2, &sequence));
+    EXPECT_TRUE(sequence.empty());
+}
+
+TEST_F(RenjuAIThreatSolverTest, opponentFives) {
+    // An open four of the opponent cannot be stopped by a three
+    set(7, 7, 1); set(7, 8, 1); set(8, 9, 1); set(9, 9, 1);
+    set(3, 3, 2); set(3, 4, 2); set(3, 5, 2); set(3, 6, 2);
+    RenjuAIBoard board(&ctx, gs.data());
+
+    std::vector<std::pair<int, int>> sequence;
+    EXPECT_FALSE(RenjuAIThreatSolver::solve(&ctx, board, 1, &sequence));
+
+    // A five is still played first
+    ASSERT_TRUE(RenjuAIThreatSolver::solve(&ctx, board, 2, &sequence));
+    ASSERT_EQ(1u, sequence.size());
+    EXPECT_EQ(3, sequence[0].first);
+    EXPECT_TRUE(sequence[0].second == 2 || sequence[0].second == 7);
+}
@@ -0,0 +1,88 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <ai/time_manager.h>
+#include <utility>
+#include <vector>
+
+class RenjuAITimeManagerTest : public ::testing::Test {
+ protected:
+    // A completed iteration with a best move
+    static RenjuAISearchIteration iteration(int depth, double time_ms, double branching_factor, int move_r) {
+        RenjuAISearchIteration it = {};
+        it.depth = depth;
+        it.completed = true;
+        it.time_ms = time_ms;
+        it.node_count = 1000;
+        it.branching_factor = branching_factor;
+        it.pv.push_back(std::make_pair(move_r, 7));
+        return it;
+    }
+};
+
+TEST_F(RenjuAITimeManagerTest, turnTime) {
+    // Turn limits keep time for writing the move
+    EXPECT_EQ(970, RenjuAITimeManager::turnTime(1000, -1, 15, 10));
+    EXPECT_EQ(90, RenjuAITimeManager::turnTime(100, -1, 15, 10));
+
+    // As fast as possible and no limit at all
+    EXPECT_EQ(0, RenjuAITimeManager::turnTime(0, 100000, 15, 10));
+    EXPECT_EQ(0, RenjuAITimeManager::turnTime(-1, -1, 15, 10));
+
+    // A share of the match time, more per move once few cells are left
+    EXPECT_EQ(2000 - 30, RenjuAITimeManager::turnTime(5000, 50000, 15, 10));
+    EXPECT_EQ(2000 - 30, RenjuAITimeManager::turnTime(-1, 50000, 15, 10));
+    EXPECT_EQ(10000 - 30, RenjuAITimeManager::turnTime(-1, 50000, 15, 215));
+
+    // Some time is left to search even if the match time is up
+    EXPECT_EQ(1, RenjuAITimeManager::turnTime(1000, 0, 15, 10));
+}
+
+TEST_F(RenjuAITimeManagerTest, nextIteration) {
+    std::vector<RenjuAISearchIteration> iterations;
+    EXPECT_FALSE(RenjuAITimeManager::nextIteration(iterations, 0, 1000));
+
+    // The next iteration is predicted with the branching factor of the last iterations
+    iterations.push_back(iteration(6, 10, 3, 1));
+    iterations.push_back(iteration(8, 40, 2, 2));
+    EXPECT_DOUBLE_EQ(2.5, RenjuAITimeManager::branchingFactor(iterations));
+    EXPECT_TRUE(RenjuAITimeManager::nextIteration(iterations, 50, 50 + 40 * 2.5 * 2.5));
+    EXPECT_FALSE(RenjuAITimeManager::nextIteration(iterations, 50, 50 + 40 * 2.5 * 2.5 - 1));
+    EXPECT_FALSE(RenjuAITimeManager::nextIteration(iterations, 50, 0));
+
+    // A stable best move shortens the limit
+    iterations.back().pv[0].first = 1;
+    EXPECT_FALSE(RenjuAITimeManager::nextIteration(iterations, 50, 50 + 40 * 2.5 * 2.5));
+    EXPECT_TRUE(RenjuAITimeManager::nextIteration(iterations, 50, (50 + 40 * 2.5 * 2.5) / 0.8));
+
+    // Forced moves and found wins end the search
+    iterations.back().node_count = 1;
+    EXPECT_FALSE(RenjuAITimeManager::nextIteration(iterations, 0, 100000));
+    iterations.back().node_count = 1000;
+    iterations.back().score = kRenjuAiEvalWinningScore;
+    EXPECT_FALSE(RenjuAITimeManager::nextIteration(iterations, 0, 100000));
+}
+
+TEST_F(RenjuAITimeManagerTest, continueDeep) {
+    // The iteration searched deeper on the previous turn has to fit in the time left
+    EXPECT_TRUE(RenjuAITimeManager::continueDeep(400, 100, 500));
+    EXPECT_FALSE(RenjuAITimeManager::continueDeep(400, 101, 500));
+    EXPECT_FALSE(RenjuAITimeManager::continueDeep(2000, 0, 1000));
+    EXPECT_TRUE(RenjuAITimeManager::continueDeep(2000, 0, 0));
+}
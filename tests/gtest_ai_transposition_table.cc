@@ -0,0 +1,177 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <ai/transposition_table.h>
+#include <ai/utils.h>
+
+class RenjuAITranspositionTableTest : public ::testing::Test {
+ protected:
+    char gs[361] = {0};
+    RenjuAITranspositionTable tt{10};
+};
+
+TEST_F(RenjuAITranspositionTableTest, probeStore) {
+    RenjuAITranspositionTable::Entry entry;
+    EXPECT_FALSE(tt.probe(12345, 1, &entry));
+
+    tt.store(12345, 1, 4, kRenjuAiTTBoundLower, 700, 3, 5);
+    EXPECT_TRUE(tt.probe(12345, 1, &entry));
+    EXPECT_EQ(700, entry.score); EXPECT_EQ(4, entry.depth); EXPECT_EQ(kRenjuAiTTBoundLower, entry.bound);
+    EXPECT_EQ(3, entry.move_r); EXPECT_EQ(5, entry.move_c);
+
+    // Different player to move
+    EXPECT_FALSE(tt.probe(12345, 2, &entry));
+
+    // Shallower results do not replace deeper ones
+    tt.store(12345, 1, 2, kRenjuAiTTBoundExact, 20, 1, 1);
+    EXPECT_TRUE(tt.probe(12345, 1, &entry));
+    EXPECT_EQ(700, entry.score); EXPECT_EQ(4, entry.depth);
+
+    tt.clear();
+    EXPECT_FALSE(tt.probe(12345, 1, &entry));
+}
+
+TEST_F(RenjuAITranspositionTableTest, buckets) {
+    // Keys of one bucket (256 buckets of 4 entries) are kept side by side
+    RenjuAITranspositionTable::Entry entry;
+    for (uint64_t i = 0; i < kRenjuAiTTBucketSlots; ++i) tt.store(7 + 256 * i, 1, 2 + i, kRenjuAiTTBoundExact, i, 0, 0);
+    for (uint64_t i = 0; i < kRenjuAiTTBucketSlots; ++i) {
+        ASSERT_TRUE(tt.probe(7 + 256 * i, 1, &entry));
+        EXPECT_EQ(static_cast<int>(i), entry.score);
+    }
+
+    // Both players of a state have entries
+    tt.store(7, 2, 8, kRenjuAiTTBoundExact, 50, 0, 0);
+    EXPECT_TRUE(tt.probe(7, 2, &entry));
+
+    // A full bucket replaces the shallowest entry
+    EXPECT_FALSE(tt.probe(7, 1, &entry));
+    EXPECT_TRUE(tt.probe(7 + 256, 1, &entry));
+    tt.store(7 + 256 * 5, 1, 2, kRenjuAiTTBoundExact, 0, 0, 0);
+    EXPECT_FALSE(tt.probe(7 + 256, 1, &entry));
+
+    // Entries of previous searches go first, a shallow new entry outlives a deeper old one
+    tt.newSearch();
+    tt.store(7 + 256 * 6, 1, 2, kRenjuAiTTBoundExact, 0, 0, 0);
+    tt.store(7 + 256 * 7, 1, 2, kRenjuAiTTBoundExact, 0, 0, 0);
+    EXPECT_TRUE(tt.probe(7 + 256 * 6, 1, &entry));
+    EXPECT_TRUE(tt.probe(7 + 256 * 7, 1, &entry));
+    EXPECT_FALSE(tt.probe(7 + 256 * 5, 1, &entry));
+    EXPECT_FALSE(tt.probe(7 + 512, 1, &entry));
+    EXPECT_TRUE(tt.probe(7, 2, &entry));
+}
+
+TEST_F(RenjuAITranspositionTableTest, isolateSearches) {
+    // Entries of previous searches are misses and replaced whatever their depth
+    RenjuAITranspositionTable::Entry entry;
+    tt.isolateSearches(true);
+    tt.store(12345, 1, 6, kRenjuAiTTBoundExact, 700, 3, 5);
+    EXPECT_TRUE(tt.probe(12345, 1, &entry));
+    tt.newSearch();
+    EXPECT_FALSE(tt.probe(12345, 1, &entry));
+    tt.store(12345, 1, 2, kRenjuAiTTBoundExact, 20, 1, 1);
+    ASSERT_TRUE(tt.probe(12345, 1, &entry));
+    EXPECT_EQ(20, entry.score);
+
+    // Also once generations wrap
+    for (int i = 0; i < 64; ++i) tt.newSearch();
+    EXPECT_FALSE(tt.probe(12345, 1, &entry));
+
+    // Kept otherwise
+    tt.isolateSearches(false);
+    tt.store(12345, 1, 2, kRenjuAiTTBoundExact, 20, 1, 1);
+    tt.newSearch();
+    EXPECT_TRUE(tt.probe(12345, 1, &entry));
+}
+
+TEST_F(RenjuAITranspositionTableTest, memory) {
+    // 16 bytes per entry
+    EXPECT_EQ(16384u, tt.memoryBytes());
+    EXPECT_EQ(static_cast<size_t>(4) << 20, RenjuAITranspositionTable::memoryBytes(kRenjuAiTTDefaultSizeLog2));
+    EXPECT_EQ(18, RenjuAITranspositionTable::sizeLog2(4));
+    EXPECT_EQ(18, RenjuAITranspositionTable::sizeLog2(7));
+    EXPECT_EQ(26, RenjuAITranspositionTable::sizeLog2(1024));
+
+    // Usage counts entries of the current search
+    EXPECT_EQ(0, tt.usage());
+    for (uint64_t i = 0; i < 512; ++i) tt.store(i, 1, 2, kRenjuAiTTBoundExact, 0, 0, 0);
+    EXPECT_DOUBLE_EQ(0.5, tt.usage());
+    tt.newSearch();
+    EXPECT_EQ(0, tt.usage());
+
+    // Resizing keeps keys and drops entries
+    uint64_t key = tt.zobrist_1[10];
+    tt.store(1, 1, 2, kRenjuAiTTBoundExact, 0, 0, 0);
+    tt.resize(12);
+    RenjuAITranspositionTable::Entry entry;
+    EXPECT_EQ(65536u, tt.memoryBytes());
+    EXPECT_EQ(key, tt.zobrist_1[10]);
+    EXPECT_FALSE(tt.probe(1, 1, &entry));
+}
+
+TEST_F(RenjuAITranspositionTableTest, zobristToggle) {
+    uint64_t hash = RenjuAIUtils::zobristHash(gs, 361, tt.zobrist_1, tt.zobrist_2);
+
+    // Incremental hash equals full hash
+    RenjuAIUtils::setCell(gs, 19, 3, 4, 1);
+    RenjuAIUtils::zobristToggle(&hash, tt.zobrist_1, tt.zobrist_2, 19, 3, 4, 1);
+    RenjuAIUtils::setCell(gs, 19, 5, 6, 2);
+    RenjuAIUtils::zobristToggle(&hash, tt.zobrist_1, tt.zobrist_2, 19, 5, 6, 2);
+    EXPECT_EQ(RenjuAIUtils::zobristHash(gs, 361, tt.zobrist_1, tt.zobrist_2), hash);
+
+    // Toggling again restores
+    RenjuAIUtils::setCell(gs, 19, 5, 6, 0);
+    RenjuAIUtils::zobristToggle(&hash, tt.zobrist_1, tt.zobrist_2, 19, 5, 6, 2);
+    RenjuAIUtils::setCell(gs, 19, 3, 4, 0);
+    RenjuAIUtils::zobristToggle(&hash, tt.zobrist_1, tt.zobrist_2, 19, 3, 4, 1);
+    EXPECT_EQ(0u, hash);
+}
+
+TEST_F(RenjuAITranspositionTableTest, symmetricHash) {
+    RenjuAIUtils::setCell(gs, 19, 3, 4, 1);
+    RenjuAIUtils::setCell(gs, 19, 5, 9, 2);
+    RenjuAIUtils::setCell(gs, 19, 10, 2, 1);
+
+    // Incremental hashes equal full hashes
+    RenjuAIUtils::SymmetricHash hash, full;
+    RenjuAIUtils::zobristHash(gs, 19, tt.zobrist_1, tt.zobrist_2, &hash);
+    RenjuAIUtils::setCell(gs, 19, 0, 18, 2);
+    RenjuAIUtils::zobristToggle(&hash, tt.zobrist_1, tt.zobrist_2, 0, 18, 2);
+    RenjuAIUtils::zobristHash(gs, 19, tt.zobrist_1, tt.zobrist_2, &full);
+    for (int s = 0; s < kRenjuAiUtilsSymmetries; ++s) EXPECT_EQ(full.keys[s], hash.keys[s]);
+
+    // All symmetric game states have the same canonical hash and share entries
+    tt.store(hash, 1, 4, kRenjuAiTTBoundExact, 100, 3, 5);
+    for (int s = 0; s < kRenjuAiUtilsSymmetries; ++s) {
+        char sgs[361];
+        RenjuAIUtils::symmetricState(gs, 19, s, sgs);
+        RenjuAIUtils::SymmetricHash shash;
+        RenjuAIUtils::zobristHash(sgs, 19, tt.zobrist_1, tt.zobrist_2, &shash);
+        EXPECT_EQ(hash.canonical(nullptr), shash.canonical(nullptr));
+        EXPECT_EQ(full.keys[s], shash.keys[0]);
+
+        // Moves are mapped to each state
+        int r, c;
+        RenjuAIUtils::symmetricCell(19, s, 3, 5, &r, &c);
+        RenjuAITranspositionTable::Entry entry;
+        ASSERT_TRUE(tt.probe(shash, 1, &entry));
+        EXPECT_EQ(r, entry.move_r); EXPECT_EQ(c, entry.move_c);
+        EXPECT_EQ(100, entry.score);
+    }
+}
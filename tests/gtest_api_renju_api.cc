@@ -0,0 +1,157 @@
+/*
+ * blupig
+ * Copyright (C) 2016-2017 Yunzhu Li
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtest/gtest.h>
+#include <api/renju_api.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+TEST(RenjuAPITest, generateMoves) {
+    const char *states[] = {
+        "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000002121000000000000001211112000000000000022122110000000000001211002200000000000002010200000000000000000200000000000000000100000000000000000000000000000000000000000000000000000000000000000000000000000000000",
+        "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001010000000000000000120000000000000002122211000000000001021112000000000000020101000000000000010202000000000000000002000000000000000002210000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000",
+        "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000200100000000000000122200000000000000011200000000000000001210000000000000000200200000000000000110000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000",
+        "invalid"
+    };
+
+    // Several copies of each state, with both players
+    std::vector<RenjuAPI::BatchItem> items;
+    for (int i = 0; i < 12; ++i) {
+        RenjuAPI::BatchItem item;
+        item.gs_string = states[i % 4];
+        item.ai_player_id = i % 3 == 0 ? 1 : 2;
+        items.push_back(item);
+    }
+    RenjuAPI::generateMoves(&items, 19, 4, 0, 3);
+
+    // Results are in input order and equal to single searches
+    for (int i = 0; i < 12; ++i) {
+        const RenjuAPI::BatchItem &item = items[i];
+        EXPECT_EQ(states[i % 4], item.gs_string);
+
+        int actual_depth, move_r, move_c, winning_player;
+        unsigned int node_count, eval_count, pm_count;
+        bool success = RenjuAPI::generateMove(item.gs_string.c_str(), 19, item.ai_player_id, 4, 0, 1,
+                                              &actual_depth, &move_r, &move_c, &winning_player,
+                                              &node_count, &eval_count, &pm_count);
+        ASSERT_EQ(success, item.success);
+        if (!success) continue;
+        EXPECT_EQ(move_r, item.move_r); EXPECT_EQ(move_c, item.move_c);
+        EXPECT_EQ(actual_depth, item.actual_depth);
+        EXPECT_EQ(node_count, item.node_count);
+    }
+}
+
+TEST(RenjuAPITest, gsFormats) {
+    const char *digits = "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000200100000000000000122200000000000000011200000000000000001210000000000000000200200000000000000110000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000";
+    std::vector<char> gs(361), decoded(361);
+    ASSERT_TRUE(RenjuAPI::gsFromString(digits, 19, gs.data()));
+
+    // Packed states take a digit per 3 cells and decode to the same state
+    std::string packed = RenjuAPI::gsToPacked(gs.data(), 19);
+    EXPECT_EQ(std::string(kRenjuAPIPackedPrefix).size() + 121, packed.size());
+    ASSERT_TRUE(RenjuAPI::gsFromString(packed.c_str(), 19, decoded.data()));
+    EXPECT_EQ(gs, decoded);
+
+    // Moves alternate from black
+    ASSERT_TRUE(RenjuAPI::gsFromString("m:jjkjjk", 19, decoded.data()));
+    EXPECT_EQ(1, decoded[19 * 9 + 9]);
+    EXPECT_EQ(2, decoded[19 * 9 + 10]);
+    EXPECT_EQ(1, decoded[19 * 10 + 9]);
+    EXPECT_EQ(358, std::count(decoded.begin(), decoded.end(), 0));
+
+    // Searches get the same result from every format
+    int r0, c0, r1, c1;
+    ASSERT_TRUE(RenjuAPI::generateMove(digits, 19, 2, 4, 0, 1, nullptr, &r0, &c0, nullptr, nullptr, nullptr, nullptr));
+    ASSERT_TRUE(RenjuAPI::generateMove(packed.c_str(), 19, 2, 4, 0, 1, nullptr, &r1, &c1, nullptr, nullptr, nullptr,
+                                       nullptr));
+    EXPECT_EQ(r0, r1); EXPECT_EQ(c0, c1);
+
+    // Invalid states
+    EXPECT_FALSE(RenjuAPI::gsFromString("m:jjjj", 19, decoded.data()));    // Cell played twice
+    EXPECT_FALSE(RenjuAPI::gsFromString("m:jjt", 19, decoded.data()));     // Incomplete move
+    EXPECT_FALSE(RenjuAPI::gsFromString("m:jjtj", 19, decoded.data()));    // Outside the board
+    EXPECT_FALSE(RenjuAPI::gsFromString("p:AAAA", 19, decoded.data()));    // Too short
+    packed[5] = '_';                                                      // A cell of value 3
+    EXPECT_FALSE(RenjuAPI::gsFromString(packed.c_str(), 19, decoded.data()));
+    std::string digits_3(digits);
+    digits_3[0] = '3';
+    EXPECT_FALSE(RenjuAPI::gsFromString(digits_3.c_str(), 19, decoded.data()));
+}
+
+TEST(RenjuAPITest, generateMoveAsync) {
+    // Progress of the completed iteration, on the searching thread (a fixed depth does not depend on timing)
+    std::vector<RenjuAPI::Progress> progress;
+    RenjuAPI::CancellationToken cancel;
+    auto search = RenjuAPI::generateMoveAsync("m:hhihii", 15, 2, 6, 0, 1,
+                                              [&progress](const RenjuAPI::Progress &p) { progress.push_back(p); },
+                                              cancel);
+    RenjuAPI::MoveResult result = search.get();
+    ASSERT_TRUE(result.success);
+    EXPECT_FALSE(result.cancelled);
+    ASSERT_EQ(1u, progress.size());
+    EXPECT_EQ(6, progress.back().depth);
+    EXPECT_EQ(result.actual_depth, progress.back().depth);
+    EXPECT_EQ(result.move_r, progress.back().move_r);
+    EXPECT_EQ(result.move_c, progress.back().move_c);
+
+    // A cancelled search ends with the best move found so far, long before its time limit.
+    // Each iteration of iterative deepening reports progress.
+    progress.clear();
+    RenjuAPI::CancellationToken long_cancel;
+    auto t_start = std::chrono::steady_clock::now();
+    auto long_search = RenjuAPI::generateMoveAsync("m:hhihhi", 15, 2, -1, 60000, 2,
+                                                   [&progress, &long_cancel](const RenjuAPI::Progress &p) {
+                                                       progress.push_back(p);
+                                                       if (p.depth >= 6) long_cancel.cancel();
+                                                   }, long_cancel);
+    result = long_search.get();
+    EXPECT_LT(std::chrono::steady_clock::now() - t_start, std::chrono::seconds(30));
+    ASSERT_TRUE(result.success);
+    EXPECT_TRUE(result.cancelled);
+    EXPECT_GE(result.actual_depth, 6);
+    EXPECT_GE(result.move_r, 0);
+    EXPECT_GE(result.move_c, 0);
+    ASSERT_FALSE(progress.empty());
+    for (size_t i = 1; i < progress.size(); ++i) {
+        EXPECT_GT(progress[i].depth, progress[i - 1].depth);
+        EXPECT_GE(progress[i].node_count, progress[i - 1].node_count);
+    }
+    EXPECT_EQ(result.actual_depth, progress.back().depth);
+
+    // Invalid input
+    EXPECT_FALSE(RenjuAPI::generateMoveAsync("m:a", 15, 1, -1, 0, 1, nullptr, RenjuAPI::CancellationToken())
+                 .get().success);
+}
+
+TEST(RenjuAPITest, tableSize) {
+    // 16 MB of 16-byte entries, rounded down to a power of 2
+    EXPECT_EQ(0u, RenjuAPI::tableSize());
+    RenjuAPI::setTableSize(24);
+    EXPECT_EQ(24u, RenjuAPI::tableSize());
+    EXPECT_EQ(20, RenjuAPI::tableSizeLog2());
+
+    int actual_depth, move_r, move_c, winning_player;
+    EXPECT_TRUE(RenjuAPI::generateMove("m:hhih", 15, 1, 4, 0, 1, &actual_depth, &move_r, &move_c, &winning_player,
+                                       nullptr, nullptr, nullptr));
+
+    RenjuAPI::setTableSize(0);
+    EXPECT_EQ(18, RenjuAPI::tableSizeLog2());
+}